@@ -0,0 +1,51 @@
+#pragma once
+#include <cfloat>
+#include "glm/glm.hpp"
+
+struct AABB {
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+
+    AABB() = default;
+    AABB(const glm::vec3& min, const glm::vec3& max) : min(min), max(max) {}
+
+    void grow(const glm::vec3& p) {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+
+    void grow(const AABB& other) {
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+
+    bool isEmpty() const {
+        return min.x > max.x || min.y > max.y || min.z > max.z;
+    }
+
+    glm::vec3 centroid() const {
+        return (min + max) * 0.5f;
+    }
+
+    float surfaceArea() const {
+        if (isEmpty()) {
+            return 0.0f;
+        }
+        glm::vec3 e = max - min;
+        return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+    }
+
+    // Slab test against a precomputed inverse direction, returns the entry distance in tNear
+    bool rayIntersect(const glm::vec3& rayOrigin, const glm::vec3& invDirection, float tMax, float& tNear) const {
+        glm::vec3 t0 = (min - rayOrigin) * invDirection;
+        glm::vec3 t1 = (max - rayOrigin) * invDirection;
+
+        glm::vec3 tSmall = glm::min(t0, t1);
+        glm::vec3 tBig = glm::max(t0, t1);
+
+        tNear = glm::max(glm::max(tSmall.x, tSmall.y), tSmall.z);
+        float tFar = glm::min(glm::min(tBig.x, tBig.y), tBig.z);
+
+        return tNear <= tFar && tFar >= 0 && tNear <= tMax;
+    }
+};
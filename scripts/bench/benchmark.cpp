@@ -0,0 +1,430 @@
+// Micro benchmarks for the intersection/shading building blocks and macro
+// benchmarks that render the wolf scene, the wolf as voxels and a million-voxel
+// terrain from fixed camera poses.
+// Prints a table and writes the same results as JSON for regression tracking.
+// Also checks that every pose renders the same pixels with and without ray packets and
+// exits with 1 when they differ.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include "../camera.h"
+#include "../color.h"
+#include "../cube.h"
+#include "../framebuffer.h"
+#include "../hdrColor.h"
+#include "../imageLoader.h"
+#include "../light.h"
+#include "../renderer.h"
+#include "../scene.h"
+#include "../skybox.h"
+#include "../sphere.h"
+#include "../threadPool.h"
+#include "../toneMap.h"
+#include "../sceneLoader.h"
+#include "../voxelGrid.h"
+#include "../sceneOptimizer.h"
+
+namespace {
+    using Clock = std::chrono::high_resolution_clock;
+
+    struct Result {
+        std::string group;
+        std::string name;
+        double nsPerOp;
+        double opsPerSecond;
+        long long iterations;
+        double mraysPerSecond;  // macro only
+    };
+
+    // Keeps results observable so the optimizer cannot drop the measured work
+    volatile float sink;
+
+    // Runs body(iterations) with a growing iteration count until one batch takes minSeconds
+    template<typename Body>
+    Result measure(const std::string& name, double minSeconds, Body body) {
+        long long iterations = 1024;
+        while (true) {
+            auto start = Clock::now();
+            body(iterations);
+            double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            if (seconds >= minSeconds || iterations > (1LL << 40)) {
+                return Result{"micro", name, seconds * 1e9 / iterations, iterations / seconds, iterations, 0.0};
+            }
+            iterations *= 2;
+        }
+    }
+
+    struct RayBatch {
+        std::vector<glm::vec3> origins;
+        std::vector<glm::vec3> directions;
+    };
+
+    // Rays from a ring around the origin aimed roughly at it, about half of them hit a unit primitive
+    RayBatch makeRays(size_t count) {
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        RayBatch batch;
+        for (size_t i = 0; i < count; i++) {
+            glm::vec3 origin = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng))) * 10.0f;
+            glm::vec3 target(unit(rng) * 2.0f, unit(rng) * 2.0f, unit(rng) * 2.0f);
+            batch.origins.push_back(origin);
+            batch.directions.push_back(glm::normalize(target - origin));
+        }
+        return batch;
+    }
+
+    std::vector<Result> runMicro(double minSeconds, Skybox& skybox, bool haveTexture) {
+        std::vector<Result> results;
+        const size_t RAYS = 4096;
+        RayBatch rays = makeRays(RAYS);
+
+        Material material = {Color(155, 155, 155), 0.9, 0.1, 10.0f, 0.0f, 0.0f};
+        Sphere sphere(glm::vec3(0.0f), 1.0f, material);
+        Cube cube(glm::vec3(-1.0f), glm::vec3(1.0f), material);
+
+        results.push_back(measure("Sphere::rayIntersect", minSeconds, [&](long long n) {
+            float acc = 0;
+            for (long long i = 0; i < n; i++) {
+                size_t r = static_cast<size_t>(i) % RAYS;
+                acc += sphere.rayIntersect(rays.origins[r], rays.directions[r]).dist;
+            }
+            sink = acc;
+        }));
+
+        results.push_back(measure("Cube::rayIntersect", minSeconds, [&](long long n) {
+            float acc = 0;
+            for (long long i = 0; i < n; i++) {
+                size_t r = static_cast<size_t>(i) % RAYS;
+                acc += cube.rayIntersect(rays.origins[r], rays.directions[r]).dist;
+            }
+            sink = acc;
+        }));
+
+        results.push_back(measure("Skybox::getColorEquirect", minSeconds, [&](long long n) {
+            int acc = 0;
+            for (long long i = 0; i < n; i++) {
+                acc += skybox.getColorEquirect(rays.directions[static_cast<size_t>(i) % RAYS]).r;
+            }
+            sink = static_cast<float>(acc);
+        }));
+
+        // Cube-map lookups one at a time and in batches of 256, nearest then bilinear; ns per direction
+        const size_t BATCH = 256;
+        std::vector<Color> skyColors(BATCH);
+        for (bool bilinear : {false, true}) {
+            skybox.setBilinear(bilinear);
+            const std::string suffix = bilinear ? " bilinear" : "";
+            results.push_back(measure("Skybox::getColor" + suffix, minSeconds, [&](long long n) {
+                int acc = 0;
+                for (long long i = 0; i < n; i++) {
+                    acc += skybox.getColor(rays.directions[static_cast<size_t>(i) % RAYS]).r;
+                }
+                sink = static_cast<float>(acc);
+            }));
+            results.push_back(measure("Skybox::getColors" + suffix, minSeconds, [&](long long n) {
+                int acc = 0;
+                for (long long i = 0; i < n; i += BATCH) {
+                    size_t first = static_cast<size_t>(i) % RAYS;
+                    skybox.getColors(std::span<const glm::vec3>(&rays.directions[first], BATCH), skyColors);
+                    acc += skyColors[BATCH - 1].r;
+                }
+                sink = static_cast<float>(acc);
+            }));
+        }
+        skybox.setBilinear(false);
+
+        if (haveTexture) {
+            results.push_back(measure("ImageLoader::getPixelColor", minSeconds, [&](long long n) {
+                int acc = 0;
+                for (long long i = 0; i < n; i++) {
+                    acc += ImageLoader::getPixelColor("bench", static_cast<int>(i & 63), static_cast<int>((i >> 6) & 63)).g;
+                }
+                sink = static_cast<float>(acc);
+            }));
+            TextureHandle texture = ImageLoader::getHandle("bench");
+            results.push_back(measure("ImageLoader::sample", minSeconds, [&](long long n) {
+                int acc = 0;
+                for (long long i = 0; i < n; i++) {
+                    acc += ImageLoader::sample(texture, static_cast<int>(i & 63), static_cast<int>((i >> 6) & 63)).g;
+                }
+                sink = static_cast<float>(acc);
+            }));
+        }
+
+        results.push_back(measure("Color * float + Color", minSeconds, [&](long long n) {
+            Color acc(0, 0, 0);
+            Color base(120, 80, 40);
+            for (long long i = 0; i < n; i++) {
+                acc = base * (static_cast<float>(i & 7) * 0.125f) + acc * 0.5f;
+            }
+            sink = acc.r;
+        }));
+
+        results.push_back(measure("HDRColor * float + HDRColor", minSeconds, [&](long long n) {
+            HDRColor acc;
+            HDRColor base(120 / 255.0f, 80 / 255.0f, 40 / 255.0f);
+            for (long long i = 0; i < n; i++) {
+                acc = base * (static_cast<float>(i & 7) * 0.125f) + acc * 0.5f;
+            }
+            sink = acc.r;
+        }));
+
+        // Resolve of a 2048x1024 radiance buffer (a power of two, so iterations stay whole frames),
+        // ns per pixel; clamp is the default, ACES with gamma the heaviest
+        const size_t PIXELS = 2048 * 1024;
+        std::vector<HDRColor> radiance(PIXELS);
+        std::vector<Color> pixels(PIXELS);
+        for (size_t i = 0; i < PIXELS; i++) {
+            radiance[i] = HDRColor((i % 97) / 48.0f, (i % 89) / 64.0f, (i % 83) / 80.0f);
+        }
+        ToneMapSettings aces;
+        aces.op = ToneMapOperator::ACES;
+        aces.gamma = 2.2f;
+        for (auto [label, settings] : {std::pair<const char*, ToneMapSettings>{"ToneMapper::apply clamp", {}},
+                                       std::pair<const char*, ToneMapSettings>{"ToneMapper::apply aces gamma", aces}}) {
+            ToneMapper toneMapper(settings);
+            results.push_back(measure(label, minSeconds, [&](long long n) {
+                for (long long i = 0; i < n; i += PIXELS) {
+                    toneMapper.apply(radiance.data(), pixels.data(), PIXELS);
+                }
+                sink = pixels[PIXELS / 2].r;
+            }));
+        }
+
+        return results;
+    }
+
+    struct Pose {
+        const char* name;
+        glm::vec3 position;
+        glm::vec3 target;
+    };
+
+    struct Resolution {
+        int width;
+        int height;
+    };
+
+    // Heightfield of about a million voxels under the wolf, in four materials by height
+    VoxelGrid* makeTerrain() {
+        const glm::ivec3 size(512, 16, 512);
+        const float voxel = 0.05f;
+        Material grass{Color(90, 140, 60), 0.9f, 0.1f, 10.0f, 0.0f, 0.0f, 0.0f};
+        VoxelGrid* terrain = new VoxelGrid(glm::vec3(-size.x * voxel * 0.5f, -2.5f, -size.z * voxel * 0.5f),
+                                           glm::vec3(voxel), size, grass);
+        const int materials[] = {
+                terrain->addMaterial(Material{Color(70, 70, 75), 0.9f, 0.1f, 10.0f, 0.0f, 0.0f, 0.0f}),
+                terrain->addMaterial(Material{Color(110, 85, 60), 0.9f, 0.1f, 10.0f, 0.0f, 0.0f, 0.0f}),
+                0,
+                terrain->addMaterial(Material{Color(0, 0, 170), 0.5f, 0.1f, 10.0f, 0.7f, 0.0f, 0.0f}),
+        };
+        for (int z = 0; z < size.z; z++) {
+            for (int x = 0; x < size.x; x++) {
+                float h = 4.5f + 2.5f * std::sin(x * 0.045f) * std::cos(z * 0.06f) + 1.5f * std::sin((x + z) * 0.11f);
+                int height = std::clamp(static_cast<int>(h), 1, size.y);
+                for (int y = 0; y < height; y++) {
+                    int layer = y == height - 1 ? (height <= 2 ? 3 : 2) : (y < height / 2 ? 0 : 1);
+                    terrain->set(glm::ivec3(x, y, z), materials[layer]);
+                }
+            }
+        }
+        return terrain;
+    }
+
+    // Pixels of one frame that differ between the packet and the scalar path
+    size_t packetMismatches(Renderer& raytracer, const Camera& camera, ThreadPool& pool, const Resolution& resolution) {
+        Framebuffer packets(resolution.width, resolution.height);
+        Framebuffer scalar(resolution.width, resolution.height);
+        raytracer.settings.usePackets = true;
+        raytracer.render(packets, camera, pool);
+        raytracer.settings.usePackets = false;
+        raytracer.render(scalar, camera, pool);
+        raytracer.settings.usePackets = true;
+
+        size_t mismatches = 0;
+        for (size_t i = 0; i < packets.pixels.size(); i++) {
+            const Color& a = packets.pixels[i];
+            const Color& b = scalar.pixels[i];
+            mismatches += a.r != b.r || a.g != b.g || a.b != b.b;
+        }
+        return mismatches;
+    }
+
+    void renderPoses(const char* label, int frames, ThreadPool& pool, Scene& scene, const Light& light,
+                     const Skybox& skybox, const std::vector<Resolution>& resolutions, std::vector<Result>& results,
+                     size_t& mismatches) {
+        Renderer raytracer(scene, light, skybox);
+
+        const Pose poses[] = {
+                {"front", glm::vec3(0.0f, 0.0f, 15.0f), glm::vec3(0.0f)},
+                {"orbit", glm::vec3(10.0f, 4.0f, 10.0f), glm::vec3(0.0f)},
+                {"close", glm::vec3(1.5f, 0.5f, 5.0f), glm::vec3(0.0f, 0.0f, 0.0f)},
+        };
+
+        for (const Resolution& resolution : resolutions) {
+            Framebuffer framebuffer(resolution.width, resolution.height);
+            for (const Pose& pose : poses) {
+                Camera camera(pose.position, pose.target, glm::vec3(0.0f, 1.0f, 0.0f), 10.0f);
+
+                if (&resolution == &resolutions.front()) {
+                    size_t differing = packetMismatches(raytracer, camera, pool, resolution);
+                    if (differing != 0) {
+                        std::printf("%s %s: %zu pixels differ between packets and --no-packets\n", label, pose.name, differing);
+                    }
+                    mismatches += differing;
+                }
+
+                // One warm-up frame, then keep the fastest of the timed ones
+                raytracer.render(framebuffer, camera, pool);
+                double best = 1e30;
+                uint64_t rays = 0;
+                for (int f = 0; f < frames; f++) {
+                    auto start = Clock::now();
+                    raytracer.render(framebuffer, camera, pool);
+                    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+                    if (seconds < best) {
+                        best = seconds;
+                        rays = raytracer.getStats().bvhRays;
+                    }
+                }
+
+                char name[64];
+                std::snprintf(name, sizeof(name), "%s %s %dx%d", label, pose.name, resolution.width, resolution.height);
+                results.push_back(Result{"macro", name, best * 1e9, 1.0 / best, frames, rays / best / 1e6});
+            }
+        }
+    }
+
+    std::vector<Result> runMacro(int frames, ThreadPool& pool, const Skybox& skybox, const std::vector<Resolution>& resolutions,
+                                 const std::string& scenePath, size_t& mismatches) {
+        SceneDescription description = loadScene(scenePath);
+        std::vector<Object*>& objects = description.objects;
+        Light light = description.light;
+        std::vector<Result> results;
+
+        Scene scene;
+        scene.build(objects);
+        renderPoses("wolf", frames, pool, scene, light, skybox, resolutions, results, mismatches);
+
+        OptimizeReport report = optimizeScene(objects);
+        std::printf("optimized wolf: %zu -> %zu objects\n", report.before, report.after);
+        scene.build(objects);
+        renderPoses("wolf optimized", frames, pool, scene, light, skybox, resolutions, results, mismatches);
+
+        // Same model with its grid-aligned cubes traced as one voxel grid, merged boxes included
+        voxelizeCubes(objects, glm::vec3(0.1f));
+        scene.build(objects);
+        renderPoses("wolf voxels", frames, pool, scene, light, skybox, resolutions, results, mismatches);
+
+        objects.push_back(makeTerrain());
+        scene.build(objects);
+        renderPoses("terrain 1M voxels", frames, pool, scene, light, skybox, resolutions, results, mismatches);
+
+        for (Object* object : objects) {
+            delete object;
+        }
+        return results;
+    }
+
+    void printTable(const std::vector<Result>& results) {
+        std::printf("%-6s %-36s %14s %14s\n", "group", "benchmark", "time", "throughput");
+        for (const Result& r : results) {
+            if (r.group == "macro") {
+                std::printf("%-6s %-36s %11.2f ms %8.2f Mrays/s\n", r.group.c_str(), r.name.c_str(), r.nsPerOp / 1e6, r.mraysPerSecond);
+            } else {
+                std::printf("%-6s %-36s %11.2f ns %8.2f Mops/s\n", r.group.c_str(), r.name.c_str(), r.nsPerOp, r.opsPerSecond / 1e6);
+            }
+        }
+    }
+
+    bool writeJson(const std::vector<Result>& results, unsigned threads, const std::string& path) {
+        std::ofstream file(path);
+        if (!file) {
+            return false;
+        }
+        file << "{\n  \"threads\": " << threads << ",\n  \"results\": [\n";
+        for (size_t i = 0; i < results.size(); i++) {
+            const Result& r = results[i];
+            file << "    {\"group\": \"" << r.group << "\", \"name\": \"" << r.name
+                 << "\", \"ns_per_op\": " << r.nsPerOp << ", \"ops_per_second\": " << r.opsPerSecond
+                 << ", \"iterations\": " << r.iterations;
+            if (r.group == "macro") {
+                file << ", \"ms_per_frame\": " << r.nsPerOp / 1e6 << ", \"mrays_per_second\": " << r.mraysPerSecond;
+            }
+            file << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        file << "  ]\n}\n";
+        return static_cast<bool>(file);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    // --quick shortens every run, --threads N sizes the pool, --json path chooses the output file,
+    // --textures dir points at the folder with minecraft.jpg and red.png, --scene at the wolf scene file
+    bool quick = false;
+    unsigned threads = 0;
+    std::string jsonPath = "benchmark.json";
+    std::string textures = "../textures";
+    std::string scenePath = "../scenes/wolf.scene";
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--quick") {
+            quick = true;
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = static_cast<unsigned>(std::max(0, std::atoi(argv[++i])));
+        } else if (arg == "--json" && i + 1 < argc) {
+            jsonPath = argv[++i];
+        } else if (arg == "--textures" && i + 1 < argc) {
+            textures = argv[++i];
+        } else if (arg == "--scene" && i + 1 < argc) {
+            scenePath = argv[++i];
+        } else {
+            std::fprintf(stderr, "usage: %s [--quick] [--threads N] [--json path] [--textures dir] [--scene path]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    Skybox skybox(textures + "/minecraft.jpg");
+    bool haveTexture = true;
+    try {
+        ImageLoader::loadImage("bench", (textures + "/red.png").c_str());
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "skipping ImageLoader benchmark: %s\n", e.what());
+        haveTexture = false;
+    }
+
+    ThreadPool pool(threads);
+    std::vector<Resolution> resolutions = {{320, 240}, {800, 600}, {1920, 1080}};
+    if (quick) {
+        resolutions.pop_back();
+    }
+
+    std::vector<Result> results = runMicro(quick ? 0.05 : 0.25, skybox, haveTexture);
+    std::vector<Result> macro;
+    size_t mismatches = 0;
+    try {
+        macro = runMacro(quick ? 2 : 5, pool, skybox, resolutions, scenePath, mismatches);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "skipping scene benchmarks: %s\n", e.what());
+    }
+    results.insert(results.end(), macro.begin(), macro.end());
+
+    printTable(results);
+    if (!writeJson(results, pool.size(), jsonPath)) {
+        std::fprintf(stderr, "could not write %s\n", jsonPath.c_str());
+        return 1;
+    }
+    std::printf("wrote %s\n", jsonPath.c_str());
+
+    if (mismatches != 0) {
+        std::printf("FAIL: packet and scalar frames differ in %zu pixels\n", mismatches);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,80 @@
+// Compares the scalar reference slab test against the SIMD kernels in boxSoA.cpp
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "../boxSoA.h"
+
+namespace {
+    const int BOX_COUNT = 4096;
+    const int RAY_COUNT = 2000;
+
+    struct Ray {
+        glm::vec3 origin;
+        glm::vec3 invDirection;
+    };
+
+    template<typename Kernel>
+    void run(const char* name, const BoxSoA& boxes, const std::vector<Ray>& rays,
+             const std::vector<BoxHit>& reference, Kernel kernel) {
+        int mismatches = 0;
+        int hits = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t r = 0; r < rays.size(); r++) {
+            BoxHit hit = kernel(rays[r]);
+            hits += hit.index >= 0;
+            if (!reference.empty() && hit.index != reference[r].index) {
+                mismatches++;
+            }
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+
+        double seconds = std::chrono::duration<double>(end - start).count();
+        double boxesPerSecond = static_cast<double>(boxes.size()) * rays.size() / seconds;
+        std::printf("%-8s %10.2f Mboxes/s  %6d hits  %d mismatches\n", name, boxesPerSecond / 1e6, hits, mismatches);
+    }
+}
+
+int main() {
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> position(-20.0f, 20.0f);
+    std::uniform_real_distribution<float> size(0.05f, 1.0f);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    BoxSoA boxes;
+    boxes.reserve(BOX_COUNT);
+    for (int i = 0; i < BOX_COUNT; i++) {
+        glm::vec3 min(position(rng), position(rng), position(rng));
+        boxes.add(AABB(min, min + glm::vec3(size(rng), size(rng), size(rng))));
+    }
+
+    std::vector<Ray> rays;
+    for (int i = 0; i < RAY_COUNT; i++) {
+        glm::vec3 direction = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)));
+        rays.push_back(Ray{glm::vec3(unit(rng), unit(rng), 30.0f), 1.0f / direction});
+    }
+
+    const int count = static_cast<int>(boxes.size());
+    std::vector<BoxHit> reference;
+    for (const Ray& ray : rays) {
+        reference.push_back(boxes.nearestHitScalar(ray.origin, ray.invDirection, 0.0f, FLT_MAX, 0, count));
+    }
+
+    std::printf("%d boxes x %d rays\n", count, RAY_COUNT);
+    run("scalar", boxes, rays, {}, [&](const Ray& ray) {
+        return boxes.nearestHitScalar(ray.origin, ray.invDirection, 0.0f, FLT_MAX, 0, count);
+    });
+#if defined(__SSE2__) || defined(_M_X64)
+    run("sse", boxes, rays, reference, [&](const Ray& ray) {
+        return boxes.nearestHitSSE(ray.origin, ray.invDirection, 0.0f, FLT_MAX, 0, count);
+    });
+#endif
+#if defined(BOXSOA_AVX2)
+    if (BoxSoA::cpuHasAVX2()) {
+        run("avx2", boxes, rays, reference, [&](const Ray& ray) {
+            return boxes.nearestHitAVX2(ray.origin, ray.invDirection, 0.0f, FLT_MAX, 0, count);
+        });
+    }
+#endif
+    return 0;
+}
@@ -0,0 +1,166 @@
+// Frame time of Raycaster::render_view with the DDA and with the old unit marching, how the
+// parallel column casting scales at 1080p and 4K, and a check that a steady-state frame does
+// not touch the heap. Exits with 1 when one does.
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../raycaster.h"
+#include "../threadPool.h"
+
+namespace {
+    std::atomic<long long> allocations{0};
+
+    struct Pose {
+        const char* name;
+        int x;
+        int y;
+        float a;
+    };
+
+    // Long east-west corridors separated by walls with a door every 16 cells
+    std::vector<std::string> makeMap(int width, int height) {
+        std::vector<std::string> rows(height, std::string(width, ' '));
+        for (int j = 0; j < height; j++) {
+            for (int i = 0; i < width; i++) {
+                bool border = i == 0 || j == 0 || i == width - 1 || j == height - 1;
+                bool divider = j % 4 == 0 && i % 16 != 8;
+                if (border || divider) {
+                    rows[j][i] = (i + j) % 2 ? '+' : '-';
+                }
+            }
+        }
+        return rows;
+    }
+
+    // Milliseconds per frame over `frames` frames after one warm-up, adding their allocations to allocated
+    template<typename Frame>
+    double measure(int frames, long long& allocated, Frame frame) {
+        frame();
+        long long before = allocations;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int f = 0; f < frames; f++) {
+            frame();
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        allocated += allocations - before;
+        return std::chrono::duration<double, std::milli>(end - start).count() / frames;
+    }
+}
+
+void* operator new(std::size_t size) {
+    allocations++;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+int main(int argc, char* argv[]) {
+    // --frames N per pose and mode, --threads N largest pool in the scaling runs (0 = one per
+    // hardware thread), --textures dir with red.png for the walls
+    int frames = 200;
+    unsigned maxThreads = 0;
+    std::string textures = "../textures";
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--frames" && i + 1 < argc) {
+            frames = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--threads" && i + 1 < argc) {
+            maxThreads = static_cast<unsigned>(std::max(0, std::atoi(argv[++i])));
+        } else if (arg == "--textures" && i + 1 < argc) {
+            textures = argv[++i];
+        } else {
+            std::fprintf(stderr, "usage: %s [--frames N] [--threads N] [--textures dir]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    try {
+        ImageLoader::loadImage("+", (textures + "/red.png").c_str());
+        ImageLoader::loadImage("-", (textures + "/red.png").c_str());
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "walls stay untextured: %s\n", e.what());
+    }
+
+    const std::vector<std::string> map = makeMap(128, 33);
+    Raycaster raycaster(nullptr);
+    raycaster.set_map(map);
+
+    const Pose poses[] = {
+        {"corridor", 2 * BLOCK + BLOCK / 2, 2 * BLOCK + BLOCK / 2, 0.05f},
+        {"across", 40 * BLOCK + BLOCK / 2, 6 * BLOCK + BLOCK / 2, 1.2f},
+        {"wall", 3 * BLOCK / 2 + 2, 2 * BLOCK + BLOCK / 2, 3.14159f},
+    };
+
+    long long steadyAllocations = 0;
+    for (bool dda : {true, false}) {
+        raycaster.useDDA = dda;
+        for (const Pose& pose : poses) {
+            raycaster.player.x = pose.x;
+            raycaster.player.y = pose.y;
+            raycaster.player.a = pose.a;
+            long long allocated = 0;
+            double ms = measure(frames, allocated, [&] { raycaster.render_view(); });
+            steadyAllocations += allocated;
+            std::printf("%-9s %-9s %dx%d %8.3f ms/frame  %lld allocations\n", dda ? "dda" : "marching", pose.name,
+                        SCREEN_WIDTH, SCREEN_HEIGHT, ms, allocated);
+        }
+    }
+
+    // Parallel column casting at the resolutions the raycaster actually runs at, 1 thread up to maxThreads
+    if (maxThreads == 0) {
+        maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    std::vector<unsigned> threadCounts;
+    for (unsigned t = 1; t < maxThreads; t *= 2) {
+        threadCounts.push_back(t);
+    }
+    threadCounts.push_back(maxThreads);
+
+    const struct {
+        const char* name;
+        int width;
+        int height;
+    } resolutions[] = {{"1080p", 1920, 1080}, {"4K", 3840, 2160}};
+    for (const auto& resolution : resolutions) {
+        Raycaster view(nullptr, resolution.width, resolution.height);
+        view.set_map(map);
+        view.player.x = poses[0].x;
+        view.player.y = poses[0].y;
+        view.player.a = poses[0].a;
+        const int scaledFrames = std::max(1, frames / 10);
+
+        double single = 0.0;
+        for (unsigned threads : threadCounts) {
+            ThreadPool pool(threads);
+            long long allocated = 0;
+            double ms = measure(scaledFrames, allocated, [&] { view.render_view(pool); });
+            steadyAllocations += allocated;
+            if (threads == 1) {
+                single = ms;
+            }
+            std::printf("dda       %-9s %dx%d %8.3f ms/frame  %2u threads  %5.2fx  %lld allocations\n",
+                        resolution.name, resolution.width, resolution.height, ms, threads, single / ms, allocated);
+        }
+    }
+
+    if (steadyAllocations != 0) {
+        std::printf("FAIL: steady-state frames allocated %lld times\n", steadyAllocations);
+        return 1;
+    }
+    std::printf("steady-state frames allocate nothing\n");
+    return 0;
+}
@@ -0,0 +1,234 @@
+#include "boxSoA.h"
+#include <limits>
+
+#if defined(BOXSOA_AVX2)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+BoxSoA::BoxSoA(const BoxSoA& other) {
+    *this = other;
+}
+
+BoxSoA& BoxSoA::operator=(const BoxSoA& other) {
+    if (this == &other) {
+        return *this;
+    }
+    count = other.count;
+    const float* arrays[6] = {other.minX, other.minY, other.minZ, other.maxX, other.maxY, other.maxZ};
+    for (int i = 0; i < 6; i++) {
+        if (arrays[i]) {
+            storage[i].assign(arrays[i], arrays[i] + count + LANES);
+        } else {
+            storage[i].clear();
+        }
+    }
+    usePointers();
+    return *this;
+}
+
+void BoxSoA::usePointers() {
+    if (storage[0].empty()) {
+        minX = minY = minZ = maxX = maxY = maxZ = nullptr;
+        return;
+    }
+    minX = storage[0].data(); minY = storage[1].data(); minZ = storage[2].data();
+    maxX = storage[3].data(); maxY = storage[4].data(); maxZ = storage[5].data();
+}
+
+void BoxSoA::clear() {
+    count = 0;
+    for (std::vector<float>& v : storage) {
+        v.clear();
+    }
+    usePointers();
+}
+
+void BoxSoA::reserve(size_t boxes) {
+    for (std::vector<float>& v : storage) {
+        v.reserve(boxes + LANES);
+    }
+    usePointers();
+}
+
+void BoxSoA::add(const AABB& box) {
+    // Drop the padding, append, then pad again so a full vector load past the end stays in bounds
+    const float bounds[6] = {box.min.x, box.min.y, box.min.z, box.max.x, box.max.y, box.max.z};
+    for (int i = 0; i < 6; i++) {
+        storage[i].resize(count);
+        storage[i].push_back(bounds[i]);
+    }
+    count++;
+    pad();
+}
+
+void BoxSoA::attach(const float* const arrays[6], size_t boxes) {
+    for (std::vector<float>& v : storage) {
+        v.clear();
+        v.shrink_to_fit();
+    }
+    count = boxes;
+    minX = arrays[0]; minY = arrays[1]; minZ = arrays[2];
+    maxX = arrays[3]; maxY = arrays[4]; maxZ = arrays[5];
+}
+
+void BoxSoA::pad() {
+    // A box with every bound at +inf never passes the slab test in any direction
+    const float inf = std::numeric_limits<float>::infinity();
+    for (std::vector<float>& v : storage) {
+        v.resize(count + LANES, inf);
+    }
+    usePointers();
+}
+
+BoxHit BoxSoA::nearestHit(const glm::vec3& rayOrigin, const glm::vec3& invDirection,
+                          float tMin, float tMax, int begin, int end, int skipIndex) const {
+#if defined(BOXSOA_AVX2)
+    static const bool avx2 = cpuHasAVX2();
+    if (avx2) {
+        return nearestHitAVX2(rayOrigin, invDirection, tMin, tMax, begin, end, skipIndex);
+    }
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+    return nearestHitSSE(rayOrigin, invDirection, tMin, tMax, begin, end, skipIndex);
+#else
+    return nearestHitScalar(rayOrigin, invDirection, tMin, tMax, begin, end, skipIndex);
+#endif
+}
+
+BoxHit BoxSoA::nearestHitScalar(const glm::vec3& rayOrigin, const glm::vec3& invDirection,
+                                float tMin, float tMax, int begin, int end, int skipIndex) const {
+    BoxHit best;
+    best.dist = tMax;
+    for (int i = begin; i < end; i++) {
+        float t0x = (minX[i] - rayOrigin.x) * invDirection.x;
+        float t1x = (maxX[i] - rayOrigin.x) * invDirection.x;
+        float t0y = (minY[i] - rayOrigin.y) * invDirection.y;
+        float t1y = (maxY[i] - rayOrigin.y) * invDirection.y;
+        float t0z = (minZ[i] - rayOrigin.z) * invDirection.z;
+        float t1z = (maxZ[i] - rayOrigin.z) * invDirection.z;
+
+        float tNear = glm::max(glm::max(glm::min(t0x, t1x), glm::min(t0y, t1y)), glm::min(t0z, t1z));
+        float tFar = glm::min(glm::min(glm::max(t0x, t1x), glm::max(t0y, t1y)), glm::max(t0z, t1z));
+
+        if (tNear <= tFar && tFar >= 0 && tNear > tMin && tNear < best.dist && i != skipIndex) {
+            best.dist = tNear;
+            best.index = i;
+        }
+    }
+    if (best.index < 0) {
+        best.dist = FLT_MAX;
+    }
+    return best;
+}
+
+#if defined(__SSE2__) || defined(_M_X64)
+BoxHit BoxSoA::nearestHitSSE(const glm::vec3& rayOrigin, const glm::vec3& invDirection,
+                             float tMin, float tMax, int begin, int end, int skipIndex) const {
+    const __m128 ox = _mm_set1_ps(rayOrigin.x), oy = _mm_set1_ps(rayOrigin.y), oz = _mm_set1_ps(rayOrigin.z);
+    const __m128 ix = _mm_set1_ps(invDirection.x), iy = _mm_set1_ps(invDirection.y), iz = _mm_set1_ps(invDirection.z);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 lower = _mm_set1_ps(tMin);
+    const __m128i endIndex = _mm_set1_epi32(end);
+    const __m128i skip = _mm_set1_epi32(skipIndex);
+
+    __m128 bestT = _mm_set1_ps(tMax);
+    __m128i bestIndex = _mm_set1_epi32(-1);
+    __m128i index = _mm_setr_epi32(begin, begin + 1, begin + 2, begin + 3);
+
+    for (int i = begin; i < end; i += 4) {
+        __m128 t0x = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&minX[i]), ox), ix);
+        __m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&maxX[i]), ox), ix);
+        __m128 t0y = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&minY[i]), oy), iy);
+        __m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&maxY[i]), oy), iy);
+        __m128 t0z = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&minZ[i]), oz), iz);
+        __m128 t1z = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&maxZ[i]), oz), iz);
+
+        __m128 tNear = _mm_max_ps(_mm_max_ps(_mm_min_ps(t0x, t1x), _mm_min_ps(t0y, t1y)), _mm_min_ps(t0z, t1z));
+        __m128 tFar = _mm_min_ps(_mm_min_ps(_mm_max_ps(t0x, t1x), _mm_max_ps(t0y, t1y)), _mm_max_ps(t0z, t1z));
+
+        __m128 hit = _mm_and_ps(_mm_cmple_ps(tNear, tFar), _mm_cmpge_ps(tFar, zero));
+        hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpgt_ps(tNear, lower), _mm_cmplt_ps(tNear, bestT)));
+        __m128i valid = _mm_andnot_si128(_mm_cmpeq_epi32(index, skip), _mm_cmplt_epi32(index, endIndex));
+        hit = _mm_and_ps(hit, _mm_castsi128_ps(valid));
+
+        bestT = _mm_or_ps(_mm_and_ps(hit, tNear), _mm_andnot_ps(hit, bestT));
+        __m128i hitI = _mm_castps_si128(hit);
+        bestIndex = _mm_or_si128(_mm_and_si128(hitI, index), _mm_andnot_si128(hitI, bestIndex));
+        index = _mm_add_epi32(index, _mm_set1_epi32(4));
+    }
+
+    alignas(16) float t[4];
+    alignas(16) int idx[4];
+    _mm_store_ps(t, bestT);
+    _mm_store_si128(reinterpret_cast<__m128i*>(idx), bestIndex);
+
+    BoxHit best;
+    for (int lane = 0; lane < 4; lane++) {
+        if (idx[lane] >= 0 && (t[lane] < best.dist || (t[lane] == best.dist && idx[lane] < best.index))) {
+            best.dist = t[lane];
+            best.index = idx[lane];
+        }
+    }
+    return best;
+}
+#endif
+
+#if defined(BOXSOA_AVX2)
+bool BoxSoA::cpuHasAVX2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+// Only this function is compiled for AVX2, without FMA, so it rounds like the SSE and scalar kernels
+__attribute__((target("avx2")))
+BoxHit BoxSoA::nearestHitAVX2(const glm::vec3& rayOrigin, const glm::vec3& invDirection,
+                              float tMin, float tMax, int begin, int end, int skipIndex) const {
+    const __m256 ox = _mm256_set1_ps(rayOrigin.x), oy = _mm256_set1_ps(rayOrigin.y), oz = _mm256_set1_ps(rayOrigin.z);
+    const __m256 ix = _mm256_set1_ps(invDirection.x), iy = _mm256_set1_ps(invDirection.y), iz = _mm256_set1_ps(invDirection.z);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 lower = _mm256_set1_ps(tMin);
+    const __m256i endIndex = _mm256_set1_epi32(end);
+    const __m256i skip = _mm256_set1_epi32(skipIndex);
+
+    __m256 bestT = _mm256_set1_ps(tMax);
+    __m256i bestIndex = _mm256_set1_epi32(-1);
+    __m256i index = _mm256_add_epi32(_mm256_set1_epi32(begin), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+
+    for (int i = begin; i < end; i += 8) {
+        __m256 t0x = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&minX[i]), ox), ix);
+        __m256 t1x = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&maxX[i]), ox), ix);
+        __m256 t0y = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&minY[i]), oy), iy);
+        __m256 t1y = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&maxY[i]), oy), iy);
+        __m256 t0z = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&minZ[i]), oz), iz);
+        __m256 t1z = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&maxZ[i]), oz), iz);
+
+        __m256 tNear = _mm256_max_ps(_mm256_max_ps(_mm256_min_ps(t0x, t1x), _mm256_min_ps(t0y, t1y)), _mm256_min_ps(t0z, t1z));
+        __m256 tFar = _mm256_min_ps(_mm256_min_ps(_mm256_max_ps(t0x, t1x), _mm256_max_ps(t0y, t1y)), _mm256_max_ps(t0z, t1z));
+
+        __m256 hit = _mm256_and_ps(_mm256_cmp_ps(tNear, tFar, _CMP_LE_OQ), _mm256_cmp_ps(tFar, zero, _CMP_GE_OQ));
+        hit = _mm256_and_ps(hit, _mm256_and_ps(_mm256_cmp_ps(tNear, lower, _CMP_GT_OQ), _mm256_cmp_ps(tNear, bestT, _CMP_LT_OQ)));
+        __m256i valid = _mm256_andnot_si256(_mm256_cmpeq_epi32(index, skip), _mm256_cmpgt_epi32(endIndex, index));
+        hit = _mm256_and_ps(hit, _mm256_castsi256_ps(valid));
+
+        bestT = _mm256_blendv_ps(bestT, tNear, hit);
+        bestIndex = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(bestIndex), _mm256_castsi256_ps(index), hit));
+        index = _mm256_add_epi32(index, _mm256_set1_epi32(8));
+    }
+
+    alignas(32) float t[8];
+    alignas(32) int idx[8];
+    _mm256_store_ps(t, bestT);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(idx), bestIndex);
+
+    BoxHit best;
+    for (int lane = 0; lane < 8; lane++) {
+        if (idx[lane] >= 0 && (t[lane] < best.dist || (t[lane] == best.dist && idx[lane] < best.index))) {
+            best.dist = t[lane];
+            best.index = idx[lane];
+        }
+    }
+    return best;
+}
+#endif
@@ -0,0 +1,71 @@
+#pragma once
+#include <cfloat>
+#include <vector>
+#include "glm/glm.hpp"
+#include "aabb.h"
+
+// GCC and Clang build the AVX2 kernel for its own function only, so the rest of the program runs
+// on any x86-64 CPU and nearestHit switches to AVX2 at runtime when the CPU has it
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define BOXSOA_AVX2 1
+#endif
+
+struct BoxHit {
+    int index = -1;
+    float dist = FLT_MAX;
+};
+
+// Axis-aligned boxes stored as one array per bound component so the slab
+// test can run on 8 (AVX2) or 4 (SSE) boxes per iteration.
+class BoxSoA {
+public:
+    static const int LANES = 8;
+
+    // Component arrays, each padded to size() + LANES. They point into the storage filled
+    // by add(), or into external memory after attach().
+    const float* minX = nullptr;
+    const float* minY = nullptr;
+    const float* minZ = nullptr;
+    const float* maxX = nullptr;
+    const float* maxY = nullptr;
+    const float* maxZ = nullptr;
+
+    BoxSoA() = default;
+    BoxSoA(const BoxSoA& other);
+    BoxSoA& operator=(const BoxSoA& other);
+
+    void clear();
+    void reserve(size_t count);
+    void add(const AABB& box);
+    size_t size() const { return count; }
+
+    // Reads boxes from six arrays laid out like minX..maxZ (count + LANES floats each, padded with
+    // +inf) without copying them. The arrays must outlive this object or the next clear().
+    void attach(const float* const arrays[6], size_t count);
+
+    // Nearest box in [begin, end) whose entry distance t satisfies tMin < t < tMax,
+    // skipping skipIndex; the lowest index among equally near ones. Same acceptance rule as
+    // Cube::rayIntersect: the box must not be entirely behind the origin, and t is the entry distance.
+    BoxHit nearestHit(const glm::vec3& rayOrigin, const glm::vec3& invDirection,
+                      float tMin, float tMax, int begin, int end, int skipIndex = -1) const;
+
+    // Reference and per-ISA kernels, nearestHit picks the widest one the build and the CPU support
+    BoxHit nearestHitScalar(const glm::vec3& rayOrigin, const glm::vec3& invDirection,
+                            float tMin, float tMax, int begin, int end, int skipIndex = -1) const;
+#if defined(__SSE2__) || defined(_M_X64)
+    BoxHit nearestHitSSE(const glm::vec3& rayOrigin, const glm::vec3& invDirection,
+                         float tMin, float tMax, int begin, int end, int skipIndex = -1) const;
+#endif
+#if defined(BOXSOA_AVX2)
+    static bool cpuHasAVX2();
+    BoxHit nearestHitAVX2(const glm::vec3& rayOrigin, const glm::vec3& invDirection,
+                          float tMin, float tMax, int begin, int end, int skipIndex = -1) const;
+#endif
+
+private:
+    void pad();
+    void usePointers();  // point the component arrays at storage
+
+    std::vector<float> storage[6];  // minX, minY, minZ, maxX, maxY, maxZ
+    size_t count = 0;
+};
@@ -0,0 +1,548 @@
+#include "bvh.h"
+#include "renderStats.h"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+
+namespace {
+    const int SAH_BINS = 16;
+    const float TRAVERSAL_COST = 1.0f;
+    const float INTERSECT_COST = 1.0f;
+
+    struct StackEntry {
+        int node;
+        float tNear;
+    };
+}
+
+void BVH::build(const PrimitiveStore& primitiveStore, const std::vector<PrimitiveRef>& refs) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    store = &primitiveStore;
+    nodeStorage.clear();
+    primitiveStorage.clear();
+    primitiveBounds.clear();
+    depth = 0;
+
+    std::vector<BuildPrimitive> build;
+    build.reserve(refs.size());
+    for (PrimitiveRef ref : refs) {
+        AABB bounds = store->getBounds(ref);
+        build.push_back(BuildPrimitive{bounds, bounds.centroid(), ref});
+    }
+
+    if (!build.empty()) {
+        nodeStorage.reserve(2 * build.size());
+        nodeStorage.push_back(BVHNode{AABB(), 0, static_cast<int>(build.size()), false});
+        subdivide(0, build, 0);
+    }
+    assert(depth < STACK_SIZE);
+
+    primitiveStorage.reserve(build.size());
+    primitiveBounds.reserve(build.size());
+    for (const BuildPrimitive& prim : build) {
+        primitiveStorage.push_back(prim.ref);
+        primitiveBounds.add(prim.bounds);
+    }
+
+    for (BVHNode& node : nodeStorage) {
+        node.boxesOnly = node.count > 0;
+        for (int i = node.first; node.count > 0 && i < node.first + node.count; i++) {
+            node.boxesOnly = node.boxesOnly && primitiveStorage[i].type == PrimitiveType::Cube;
+        }
+    }
+
+    nodes = nodeStorage;
+    primitives = primitiveStorage;
+
+    auto end = std::chrono::high_resolution_clock::now();
+    buildTimeMs = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void BVH::subdivide(int nodeIndex, std::vector<BuildPrimitive>& build, int level) {
+    depth = std::max(depth, level);
+    const int first = nodeStorage[nodeIndex].first;
+    const int count = nodeStorage[nodeIndex].count;
+    auto begin = build.begin() + first;
+    auto end = begin + count;
+
+    AABB nodeBounds;
+    AABB centroidBounds;
+    for (auto it = begin; it != end; ++it) {
+        nodeBounds.grow(it->bounds);
+        centroidBounds.grow(it->centroid);
+    }
+    nodeStorage[nodeIndex].bounds = nodeBounds;
+
+    if (count <= 2) {
+        return;
+    }
+
+    // Binned SAH: evaluate SAH_BINS - 1 split planes on every axis
+    int bestAxis = -1;
+    int bestSplit = 0;
+    float bestCost = INTERSECT_COST * count;
+    glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+    float parentArea = nodeBounds.surfaceArea();
+
+    for (int axis = 0; axis < 3 && level < SAH_MAX_DEPTH; axis++) {
+        if (extent[axis] <= 0.0f) {
+            continue;
+        }
+
+        AABB binBounds[SAH_BINS];
+        int binCount[SAH_BINS] = {};
+        float scale = SAH_BINS / extent[axis];
+        for (auto it = begin; it != end; ++it) {
+            int bin = std::min(SAH_BINS - 1, static_cast<int>((it->centroid[axis] - centroidBounds.min[axis]) * scale));
+            binCount[bin]++;
+            binBounds[bin].grow(it->bounds);
+        }
+
+        float leftArea[SAH_BINS - 1];
+        int leftCount[SAH_BINS - 1];
+        AABB acc;
+        int sum = 0;
+        for (int b = 0; b < SAH_BINS - 1; b++) {
+            acc.grow(binBounds[b]);
+            sum += binCount[b];
+            leftArea[b] = acc.surfaceArea();
+            leftCount[b] = sum;
+        }
+
+        acc = AABB();
+        sum = 0;
+        for (int b = SAH_BINS - 1; b > 0; b--) {
+            acc.grow(binBounds[b]);
+            sum += binCount[b];
+            if (leftCount[b - 1] == 0 || sum == 0) {
+                continue;
+            }
+            float cost = TRAVERSAL_COST +
+                         INTERSECT_COST * (leftArea[b - 1] * leftCount[b - 1] + acc.surfaceArea() * sum) / parentArea;
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = b;
+            }
+        }
+    }
+
+    auto mid = begin;
+    if (bestAxis >= 0) {
+        float scale = SAH_BINS / extent[bestAxis];
+        float minCentroid = centroidBounds.min[bestAxis];
+        mid = std::partition(begin, end, [&](const BuildPrimitive& prim) {
+            return std::min(SAH_BINS - 1, static_cast<int>((prim.centroid[bestAxis] - minCentroid) * scale)) < bestSplit;
+        });
+    } else if (count > MAX_LEAF_SIZE) {
+        // No split beats a leaf, or the tree is already SAH_MAX_DEPTH deep, but the leaf is too big:
+        // fall back to a median split
+        int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+        mid = begin + count / 2;
+        std::nth_element(begin, mid, end, [axis](const BuildPrimitive& a, const BuildPrimitive& b) {
+            return a.centroid[axis] < b.centroid[axis];
+        });
+    } else {
+        return;
+    }
+
+    int leftCount = static_cast<int>(mid - begin);
+    int left = static_cast<int>(nodeStorage.size());
+    nodeStorage.push_back(BVHNode{AABB(), first, leftCount, false});
+    nodeStorage.push_back(BVHNode{AABB(), first + leftCount, count - leftCount, false});
+    nodeStorage[nodeIndex].first = left;
+    nodeStorage[nodeIndex].count = 0;
+
+    subdivide(left, build, level + 1);
+    subdivide(left + 1, build, level + 1);
+}
+
+bool BVH::closestHit(const glm::vec3& rayOrigin, const glm::vec3& rayDirection,
+                     Intersect& intersect, const Object*& hitObject,
+                     const Object* ignore, float tMin) const {
+    hitObject = nullptr;
+    float tRoot;
+    const glm::vec3 invDirection = 1.0f / rayDirection;
+    if (nodes.empty() || !nodes[0].bounds.rayIntersect(rayOrigin, invDirection, FLT_MAX, tRoot)) {
+        RenderStats::local().bvhRays++;
+        return false;
+    }
+
+    // Exact ties, e.g. coplanar faces of touching boxes, go to the lowest primitive index so the
+    // result does not depend on traversal order and matches closestHitPacket
+    float closest = FLT_MAX;
+    int best = -1;
+    uint64_t visited = 0;
+    RenderStats& stats = RenderStats::local();
+
+    StackEntry stack[STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize++] = StackEntry{0, tRoot};
+
+    while (stackSize > 0) {
+        StackEntry entry = stack[--stackSize];
+        if (entry.tNear > closest) {
+            continue;
+        }
+
+        const BVHNode& node = nodes[entry.node];
+        visited++;
+
+        if (node.boxesOnly) {
+            // Slab test the whole leaf at once, then compute point and normal for the winner only
+            int skipIndex = -1;
+            for (int i = node.first; ignore && i < node.first + node.count; i++) {
+                if (&store->get(primitives[i]) == ignore) {
+                    skipIndex = i;
+                }
+            }
+            BoxHit box = primitiveBounds.nearestHit(rayOrigin, invDirection, tMin, std::nextafter(closest, FLT_MAX),
+                                                    node.first, node.first + node.count, skipIndex);
+            stats.countTest(PrimitiveType::Cube, node.count);
+            if (box.index >= 0 && (box.dist < closest || box.index < best)) {
+                Intersect hit = store->rayIntersect(primitives[box.index], rayOrigin, rayDirection);
+                if (hit.isIntersecting) {
+                    closest = box.dist;
+                    best = box.index;
+                    intersect = hit;
+                    hitObject = &store->get(primitives[box.index]);
+                }
+            }
+            continue;
+        }
+
+        if (node.count > 0) {
+            for (int i = node.first; i < node.first + node.count; i++) {
+                const Object* object = &store->get(primitives[i]);
+                if (object == ignore) {
+                    continue;
+                }
+                Intersect hit = store->rayIntersect(primitives[i], rayOrigin, rayDirection);
+                stats.countTest(primitives[i].type);
+                if (hit.isIntersecting && hit.dist > tMin && (hit.dist < closest || (hit.dist == closest && i < best))) {
+                    closest = hit.dist;
+                    best = i;
+                    intersect = hit;
+                    hitObject = object;
+                }
+            }
+            continue;
+        }
+
+        // Push the farther child first so the nearer one is visited next
+        assert(stackSize + 2 <= STACK_SIZE);
+        StackEntry left{node.first, 0.0f};
+        StackEntry right{node.first + 1, 0.0f};
+        bool hitLeft = nodes[left.node].bounds.rayIntersect(rayOrigin, invDirection, closest, left.tNear);
+        bool hitRight = nodes[right.node].bounds.rayIntersect(rayOrigin, invDirection, closest, right.tNear);
+        if (hitLeft && hitRight) {
+            if (left.tNear > right.tNear) {
+                std::swap(left, right);
+            }
+            stack[stackSize++] = right;
+            stack[stackSize++] = left;
+        } else if (hitLeft) {
+            stack[stackSize++] = left;
+        } else if (hitRight) {
+            stack[stackSize++] = right;
+        }
+    }
+
+    stats.bvhRays++;
+    stats.nodesVisited += visited;
+    return hitObject != nullptr;
+}
+
+AABB BVH::primitiveBox(int index) const {
+    return AABB(glm::vec3(primitiveBounds.minX[index], primitiveBounds.minY[index], primitiveBounds.minZ[index]),
+                glm::vec3(primitiveBounds.maxX[index], primitiveBounds.maxY[index], primitiveBounds.maxZ[index]));
+}
+
+void BVH::pushChildrenPacket(const BVHNode& node, const RayPacket& packet, int* stack, int& stackSize) const {
+    assert(stackSize + 2 <= STACK_SIZE);
+    // Order the children along the direction of the first active lane, nearer one on top
+    int lane = 0;
+    while (!(packet.activeMask & (1 << lane))) {
+        lane++;
+    }
+    glm::vec3 direction = packet.direction(lane);
+    int left = node.first;
+    int right = node.first + 1;
+    float dLeft = glm::dot(nodes[left].bounds.centroid() - packet.origin, direction);
+    float dRight = glm::dot(nodes[right].bounds.centroid() - packet.origin, direction);
+    if (dLeft > dRight) {
+        std::swap(left, right);
+    }
+    stack[stackSize++] = right;
+    stack[stackSize++] = left;
+}
+
+bool BVH::leafOccluder(const BVHNode& node, const glm::vec3& rayOrigin, const glm::vec3& rayDirection,
+                       const glm::vec3& invDirection, const Object* ignore, float& nearest, RenderStats& stats) const {
+    if (node.boxesOnly) {
+        int skipIndex = -1;
+        for (int i = node.first; ignore && i < node.first + node.count; i++) {
+            if (&store->get(primitives[i]) == ignore) {
+                skipIndex = i;
+            }
+        }
+        BoxHit box = primitiveBounds.nearestHit(rayOrigin, invDirection, BIAS, nearest,
+                                                node.first, node.first + node.count, skipIndex);
+        stats.countTest(PrimitiveType::Cube, node.count);
+        if (box.index >= 0) {
+            nearest = box.dist;
+            return true;
+        }
+        return false;
+    }
+
+    bool found = false;
+    for (int i = node.first; i < node.first + node.count; i++) {
+        if (&store->get(primitives[i]) == ignore) {
+            continue;
+        }
+        stats.countTest(primitives[i].type);
+        float t;
+        if (store->occluded(primitives[i], rayOrigin, rayDirection, nearest, &t)) {
+            nearest = t;
+            found = true;
+        }
+    }
+    return found;
+}
+
+bool BVH::nearestOccluder(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, float tMax,
+                          const Object* ignore, float& tHit) const {
+    float tRoot;
+    const glm::vec3 invDirection = 1.0f / rayDirection;
+    if (nodes.empty() || !nodes[0].bounds.rayIntersect(rayOrigin, invDirection, tMax, tRoot)) {
+        RenderStats::local().bvhRays++;
+        return false;
+    }
+
+    // Front to back like closestHit, every occluder found shortens the ray
+    float nearest = tMax;
+    bool found = false;
+    uint64_t visited = 0;
+    RenderStats& stats = RenderStats::local();
+
+    StackEntry stack[STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize++] = StackEntry{0, tRoot};
+
+    while (stackSize > 0) {
+        StackEntry entry = stack[--stackSize];
+        if (entry.tNear > nearest) {
+            continue;
+        }
+
+        const BVHNode& node = nodes[entry.node];
+        visited++;
+
+        if (node.count > 0) {
+            found |= leafOccluder(node, rayOrigin, rayDirection, invDirection, ignore, nearest, stats);
+            continue;
+        }
+
+        assert(stackSize + 2 <= STACK_SIZE);
+        StackEntry left{node.first, 0.0f};
+        StackEntry right{node.first + 1, 0.0f};
+        bool hitLeft = nodes[left.node].bounds.rayIntersect(rayOrigin, invDirection, nearest, left.tNear);
+        bool hitRight = nodes[right.node].bounds.rayIntersect(rayOrigin, invDirection, nearest, right.tNear);
+        if (hitLeft && hitRight) {
+            if (left.tNear > right.tNear) {
+                std::swap(left, right);
+            }
+            stack[stackSize++] = right;
+            stack[stackSize++] = left;
+        } else if (hitLeft) {
+            stack[stackSize++] = left;
+        } else if (hitRight) {
+            stack[stackSize++] = right;
+        }
+    }
+
+    if (found) {
+        tHit = nearest;
+    }
+    stats.bvhRays++;
+    stats.nodesVisited += visited;
+    return found;
+}
+
+void BVH::closestHitPacket(const RayPacket& packet, Intersect intersects[RayPacket::SIZE],
+                           const Object* hitObjects[RayPacket::SIZE]) const {
+    // closest is the nearest hit per lane and limit the next float above it, so boxes at exactly
+    // closest still pass the strict slab test and ties go to the lowest index like in closestHit
+    alignas(16) float closest[RayPacket::SIZE];
+    alignas(16) float limit[RayPacket::SIZE];
+    alignas(16) float lower[RayPacket::SIZE];
+    alignas(16) float tNear[RayPacket::SIZE];
+    int best[RayPacket::SIZE];
+    for (int lane = 0; lane < RayPacket::SIZE; lane++) {
+        closest[lane] = FLT_MAX;
+        limit[lane] = FLT_MAX;
+        lower[lane] = -FLT_MAX;
+        best[lane] = -1;
+        hitObjects[lane] = nullptr;
+    }
+
+    if (nodes.empty() || packet.activeMask == 0) {
+        return;
+    }
+
+    uint64_t visited = 0;
+    RenderStats& stats = RenderStats::local();
+    const uint64_t lanes = std::popcount(static_cast<unsigned>(packet.activeMask));
+    int stack[STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0) {
+        const BVHNode& node = nodes[stack[--stackSize]];
+        visited++;
+
+        if (!packetSlab(packet, node.bounds, lower, limit, tNear)) {
+            continue;
+        }
+
+        if (node.count == 0) {
+            pushChildrenPacket(node, packet, stack, stackSize);
+            continue;
+        }
+
+        for (int i = node.first; i < node.first + node.count; i++) {
+            stats.countTest(primitives[i].type, lanes);
+            if (primitives[i].type == PrimitiveType::Cube) {
+                int mask = packetSlab(packet, primitiveBox(i), lower, limit, tNear);
+                for (int lane = 0; mask; lane++, mask >>= 1) {
+                    if ((mask & 1) && (tNear[lane] < closest[lane] || i < best[lane])) {
+                        closest[lane] = tNear[lane];
+                        limit[lane] = std::nextafter(tNear[lane], FLT_MAX);
+                        best[lane] = i;
+                    }
+                }
+                continue;
+            }
+
+            for (int lane = 0; lane < RayPacket::SIZE; lane++) {
+                if (!(packet.activeMask & (1 << lane))) {
+                    continue;
+                }
+                Intersect hit = store->rayIntersect(primitives[i], packet.origin, packet.direction(lane));
+                if (hit.isIntersecting && (hit.dist < closest[lane] || (hit.dist == closest[lane] && i < best[lane]))) {
+                    closest[lane] = hit.dist;
+                    limit[lane] = std::nextafter(hit.dist, FLT_MAX);
+                    best[lane] = i;
+                }
+            }
+        }
+    }
+
+    // Point and normal are only computed for the winning primitive of each lane
+    int rays = 0;
+    for (int lane = 0; lane < RayPacket::SIZE; lane++) {
+        if (!(packet.activeMask & (1 << lane))) {
+            continue;
+        }
+        rays++;
+        if (best[lane] >= 0) {
+            intersects[lane] = store->rayIntersect(primitives[best[lane]], packet.origin, packet.direction(lane));
+            hitObjects[lane] = intersects[lane].isIntersecting ? &store->get(primitives[best[lane]]) : nullptr;
+        }
+    }
+
+    stats.bvhRays += rays;
+    stats.nodesVisited += visited;
+}
+
+int BVH::nearestOccluderPacket(const glm::vec3 origins[RayPacket::SIZE], const glm::vec3 directions[RayPacket::SIZE],
+                               const float tMax[RayPacket::SIZE], const Object* const ignore[RayPacket::SIZE],
+                               int activeMask, float tHit[RayPacket::SIZE]) const {
+    if (nodes.empty() || activeMask == 0) {
+        return 0;
+    }
+
+    // Same leaf tests and limits as nearestOccluder per lane, only the node walk is shared. The
+    // nearest occluder does not depend on the order nodes are visited in, so the distances match.
+    glm::vec3 invDirection[RayPacket::SIZE];
+    float nearest[RayPacket::SIZE];
+    for (int lane = 0; lane < RayPacket::SIZE; lane++) {
+        if (activeMask & (1 << lane)) {
+            invDirection[lane] = 1.0f / directions[lane];
+            nearest[lane] = tMax[lane];
+        }
+    }
+
+    int found = 0;
+    uint64_t visited = 0;
+    RenderStats& stats = RenderStats::local();
+    int stack[STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0) {
+        const BVHNode& node = nodes[stack[--stackSize]];
+        visited++;
+
+        int mask = 0;
+        for (int lane = 0; lane < RayPacket::SIZE; lane++) {
+            float tNear;
+            if ((activeMask & (1 << lane)) &&
+                node.bounds.rayIntersect(origins[lane], invDirection[lane], nearest[lane], tNear)) {
+                mask |= 1 << lane;
+            }
+        }
+        if (mask == 0) {
+            continue;
+        }
+
+        if (node.count > 0) {
+            for (int lane = 0; lane < RayPacket::SIZE; lane++) {
+                if ((mask & (1 << lane)) &&
+                    leafOccluder(node, origins[lane], directions[lane], invDirection[lane], ignore[lane], nearest[lane], stats)) {
+                    found |= 1 << lane;
+                }
+            }
+            continue;
+        }
+
+        // Nearer child on top along the first lane that reached this node
+        assert(stackSize + 2 <= STACK_SIZE);
+        int lane = std::countr_zero(static_cast<unsigned>(mask));
+        int left = node.first;
+        int right = node.first + 1;
+        float dLeft = glm::dot(nodes[left].bounds.centroid() - origins[lane], directions[lane]);
+        float dRight = glm::dot(nodes[right].bounds.centroid() - origins[lane], directions[lane]);
+        if (dLeft > dRight) {
+            std::swap(left, right);
+        }
+        stack[stackSize++] = right;
+        stack[stackSize++] = left;
+    }
+
+    for (int lane = 0; lane < RayPacket::SIZE; lane++) {
+        if (found & (1 << lane)) {
+            tHit[lane] = nearest[lane];
+        }
+    }
+    stats.bvhRays += std::popcount(static_cast<unsigned>(activeMask));
+    stats.nodesVisited += visited;
+    return found;
+}
+
+void BVH::attach(const PrimitiveStore& primitiveStore, std::span<const BVHNode> nodeArray,
+                 std::span<const PrimitiveRef> primitiveArray, const float* const bounds[6], int treeDepth) {
+    assert(treeDepth < STACK_SIZE);
+    store = &primitiveStore;
+    nodeStorage.clear();
+    primitiveStorage.clear();
+    nodes = nodeArray;
+    primitives = primitiveArray;
+    primitiveBounds.attach(bounds, primitiveArray.size());
+    depth = treeDepth;
+    buildTimeMs = 0.0;
+}
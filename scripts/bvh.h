@@ -0,0 +1,96 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "glm/glm.hpp"
+#include "aabb.h"
+#include "boxSoA.h"
+#include "intersect.h"
+#include "object.h"
+#include "primitives.h"
+#include "rayPacket.h"
+
+struct RenderStats;
+
+struct BVHNode {
+    AABB bounds;
+    int first;  // leaf: index of the first primitive, inner: index of the left child (right is first + 1)
+    int count;  // number of primitives, 0 for inner nodes
+    bool boxesOnly;  // leaf holds only cubes and can use the SIMD slab kernel
+};
+
+// Bounding volume hierarchy over the primitives of a PrimitiveStore, split with the
+// surface area heuristic. The store must outlive the BVH and not be modified after build().
+// Queries count their rays and visited nodes into RenderStats::local().
+class BVH {
+public:
+    static const int MAX_LEAF_SIZE = 8;
+    // Entries of the fixed traversal stacks. Ordered traversal keeps at most depth + 1 nodes on them.
+    static const int STACK_SIZE = 64;
+    // Below this depth build() only does median splits, so nested or skewed geometry can add at
+    // most log2(count) more levels and every tree stays shallower than STACK_SIZE
+    static const int SAH_MAX_DEPTH = 32;
+
+    void build(const PrimitiveStore& store, const std::vector<PrimitiveRef>& refs);
+
+    // Uses a hierarchy built earlier, e.g. memory-mapped from a compiled scene, without copying it.
+    // The arrays must outlive the BVH; bounds are the six padded BoxSoA component arrays and
+    // treeDepth the getDepth() of the tree they were built as, below STACK_SIZE.
+    void attach(const PrimitiveStore& store, std::span<const BVHNode> nodes,
+                std::span<const PrimitiveRef> primitives, const float* const bounds[6], int treeDepth);
+
+    // Built arrays, in the form attach() takes them back
+    std::span<const BVHNode> getNodes() const { return nodes; }
+    std::span<const PrimitiveRef> getPrimitives() const { return primitives; }
+    const BoxSoA& getPrimitiveBounds() const { return primitiveBounds; }
+
+    // Nearest hit with dist > tMin, skipping `ignore`. Returns false when nothing was hit.
+    bool closestHit(const glm::vec3& rayOrigin, const glm::vec3& rayDirection,
+                    Intersect& intersect, const Object*& hitObject,
+                    const Object* ignore = nullptr, float tMin = -FLT_MAX) const;
+
+    // Nearest hit with BIAS <= t <= tMax, skipping `ignore`, without point or normal. Its
+    // distance goes to tHit.
+    bool nearestOccluder(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, float tMax,
+                         const Object* ignore, float& tHit) const;
+
+    // closestHit for every active lane of a packet. hitObjects[lane] is nullptr on a miss.
+    void closestHitPacket(const RayPacket& packet, Intersect intersects[RayPacket::SIZE],
+                          const Object* hitObjects[RayPacket::SIZE]) const;
+
+    // nearestOccluder for the lanes in activeMask, each with its own origin, walked through the
+    // tree together. Returns the mask of lanes that found an occluder, whose distance goes to
+    // tHit[lane]; the distances are exactly the ones nearestOccluder returns.
+    int nearestOccluderPacket(const glm::vec3 origins[RayPacket::SIZE], const glm::vec3 directions[RayPacket::SIZE],
+                              const float tMax[RayPacket::SIZE], const Object* const ignore[RayPacket::SIZE],
+                              int activeMask, float tHit[RayPacket::SIZE]) const;
+
+    size_t nodeCount() const { return nodes.size(); }
+    int getDepth() const { return depth; }
+    double getBuildTimeMs() const { return buildTimeMs; }
+
+private:
+    struct BuildPrimitive {
+        AABB bounds;
+        glm::vec3 centroid;
+        PrimitiveRef ref;
+    };
+
+    void subdivide(int nodeIndex, std::vector<BuildPrimitive>& build, int level);
+    AABB primitiveBox(int index) const;
+    void pushChildrenPacket(const BVHNode& node, const RayPacket& packet, int* stack, int& stackSize) const;
+    // Shortens `nearest` to the closest occluder in a leaf, false when the leaf has none nearer
+    bool leafOccluder(const BVHNode& node, const glm::vec3& rayOrigin, const glm::vec3& rayDirection,
+                      const glm::vec3& invDirection, const Object* ignore, float& nearest, RenderStats& stats) const;
+
+    // Traversal reads nodes and primitives, which view either the storage filled by build()
+    // or the arrays given to attach()
+    std::vector<BVHNode> nodeStorage;
+    std::vector<PrimitiveRef> primitiveStorage;
+    std::span<const BVHNode> nodes;
+    std::span<const PrimitiveRef> primitives;
+    const PrimitiveStore* store = nullptr;
+    BoxSoA primitiveBounds;  // bounds of primitives[i], same order
+    double buildTimeMs = 0.0;
+    int depth = 0;  // levels below the root, 0 for a single leaf
+};
@@ -5,12 +5,25 @@
 #include "material.h"
 #include "intersect.h"
 
-class Cube : public Object {
+class Cube final : public Object {
 public:
     Cube(const glm::vec3& minCorner, const glm::vec3& maxCorner, const Material& mat);
 
     Intersect rayIntersect(const glm::vec3& rayOrigin, const glm::vec3& rayDirection) const override;
 
+    // Non-virtual slab test, inlined into the typed loops of PrimitiveStore
+    Intersect intersect(const glm::vec3& rayOrigin, const glm::vec3& rayDirection) const;
+
+    bool occluded(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, float tMax, float* tHit = nullptr) const override;
+
+    // Non-virtual any-hit test without point or normal
+    bool occludes(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, float tMax, float* tHit = nullptr) const;
+
+    AABB getBounds() const override;
+
+    // Corners as given to the constructor, unsorted
+    const glm::vec3& getMinCorner() const { return minCorner; }
+    const glm::vec3& getMaxCorner() const { return maxCorner; }
 
     // Método para establecer la textura del cubo
     void setTexture(SDL_Texture* tex) {
@@ -21,3 +34,56 @@ private:
     glm::vec3 maxCorner;
     SDL_Texture* texture;
 };
+
+inline Intersect Cube::intersect(const glm::vec3& rayOrigin, const glm::vec3& rayDirection) const {
+    glm::vec3 tMin = (minCorner - rayOrigin) / rayDirection;
+    glm::vec3 tMax = (maxCorner - rayOrigin) / rayDirection;
+
+    glm::vec3 t1 = glm::min(tMin, tMax);
+    glm::vec3 t2 = glm::max(tMin, tMax);
+
+    float tNear = glm::max(glm::max(t1.x, t1.y), t1.z);
+    float tFar = glm::min(glm::min(t2.x, t2.y), t2.z);
+
+    if (tNear > tFar || tFar < 0) {
+        return Intersect{false};
+    }
+
+    glm::vec3 point = rayOrigin + tNear * rayDirection;
+
+    glm::vec3 normal;
+    if (point.x < minCorner.x + 1e-5) {
+        normal = glm::vec3(-1.0f, 0.0f, 0.0f);
+    } else if (point.x > maxCorner.x - 1e-5) {
+        normal = glm::vec3(1.0f, 0.0f, 0.0f);
+    } else if (point.y < minCorner.y + 1e-5) {
+        normal = glm::vec3(0.0f, -1.0f, 0.0f);
+    } else if (point.y > maxCorner.y - 1e-5) {
+        normal = glm::vec3(0.0f, 1.0f, 0.0f);
+    } else if (point.z < minCorner.z + 1e-5) {
+        normal = glm::vec3(0.0f, 0.0f, -1.0f);
+    } else if (point.z > maxCorner.z - 1e-5) {
+        normal = glm::vec3(0.0f, 0.0f, 1.0f);
+    }
+
+    return Intersect{true, tNear, point, normal};
+}
+
+inline bool Cube::occludes(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, float tMax, float* tHit) const {
+    glm::vec3 t0 = (minCorner - rayOrigin) / rayDirection;
+    glm::vec3 t1 = (maxCorner - rayOrigin) / rayDirection;
+
+    glm::vec3 tSmall = glm::min(t0, t1);
+    glm::vec3 tBig = glm::max(t0, t1);
+
+    float tNear = glm::max(glm::max(tSmall.x, tSmall.y), tSmall.z);
+    float tFar = glm::min(glm::min(tBig.x, tBig.y), tBig.z);
+
+    if (tNear > tFar || tNear < BIAS || tNear > tMax) {
+        return false;
+    }
+    if (tHit) {
+        *tHit = tNear;
+    }
+    return true;
+}
@@ -0,0 +1,66 @@
+#include "frameCache.h"
+
+namespace {
+    // Van der Corput radical inverse, base 2 and 3 together give a Halton sequence
+    float radicalInverse(int index, int base) {
+        float result = 0.0f;
+        float fraction = 1.0f / base;
+        while (index > 0) {
+            result += (index % base) * fraction;
+            index /= base;
+            fraction /= base;
+        }
+        return result;
+    }
+}
+
+ViewState ViewState::capture(const Camera& camera, const Light& light, const Scene& scene, const RenderSettings& settings) {
+    return ViewState{camera.position, camera.target, camera.up,
+                     light.position, light.intensity, light.color,
+                     scene.revision, settings};
+}
+
+bool ViewState::operator==(const ViewState& other) const {
+    return cameraPosition == other.cameraPosition && cameraTarget == other.cameraTarget &&
+           cameraUp == other.cameraUp && settings.toneMap == other.settings.toneMap && sameShading(other);
+}
+
+bool ViewState::sameShading(const ViewState& other) const {
+    return lightPosition == other.lightPosition &&
+           lightIntensity == other.lightIntensity &&
+           lightColor.r == other.lightColor.r && lightColor.g == other.lightColor.g &&
+           lightColor.b == other.lightColor.b && lightColor.a == other.lightColor.a &&
+           sceneRevision == other.sceneRevision &&
+           settings.maxRecursion == other.settings.maxRecursion && settings.fov == other.settings.fov &&
+           settings.usePackets == other.settings.usePackets;
+}
+
+FrameCache::FrameCache(int width, int height)
+        : framebuffer(width, height), sums(static_cast<size_t>(width) * height) {}
+
+void FrameCache::store(const ViewState& state, int step) {
+    cached = state;
+    valid = true;
+    currentStep = step;
+    samples = step == 1 ? 1 : 0;
+    if (step != 1) {
+        return;
+    }
+    sums = framebuffer.radiance;
+}
+
+void FrameCache::accumulate(const Framebuffer& sample) {
+    samples++;
+    const float scale = 1.0f / samples;
+    for (size_t i = 0; i < sums.size(); i++) {
+        sums[i] += sample.radiance[i];
+        framebuffer.radiance[i] = sums[i] * scale;
+    }
+}
+
+glm::vec2 FrameCache::sampleOffset(int index) {
+    if (index <= 0) {
+        return glm::vec2(0.5f);
+    }
+    return glm::vec2(radicalInverse(index, 2), radicalInverse(index, 3));
+}
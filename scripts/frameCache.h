@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+#include "camera.h"
+#include "framebuffer.h"
+#include "hdrColor.h"
+#include "light.h"
+#include "renderer.h"
+#include "scene.h"
+
+// Everything the rendered image depends on. Two equal states produce the same frame.
+struct ViewState {
+    glm::vec3 cameraPosition;
+    glm::vec3 cameraTarget;
+    glm::vec3 cameraUp;
+    glm::vec3 lightPosition;
+    float lightIntensity;
+    Color lightColor;
+    uint64_t sceneRevision;
+    RenderSettings settings;
+
+    static ViewState capture(const Camera& camera, const Light& light, const Scene& scene, const RenderSettings& settings);
+    bool operator==(const ViewState& other) const;
+
+    // Everything but the camera and tone mapping matches, so surface radiance seen from one view is still valid in the other
+    bool sameShading(const ViewState& other) const;
+};
+
+// Last rendered frame plus the state it was rendered from. While the state does not
+// change the frame can be refined from a coarse progressive pass down to full resolution,
+// improved with extra jittered samples, or presented again as is.
+class FrameCache {
+public:
+    FrameCache(int width, int height);
+
+    // True when `state` differs from the cached frame or nothing was rendered yet
+    bool isDirty(const ViewState& state) const { return !valid || !(state == cached); }
+
+    // framebuffer was just rendered from `state`, with one sample per step x step block
+    void store(const ViewState& state, int step = 1);
+
+    // Grid spacing of the cached frame, 1 once every pixel was traced
+    int step() const { return currentStep; }
+
+    // Averages another full-frame sample into framebuffer's radiance, which still
+    // has to be resolved into its pixels (Renderer::resolve)
+    void accumulate(const Framebuffer& sample);
+
+    int sampleCount() const { return samples; }
+
+    // Sub-pixel position of extra sample `index` (>= 1), index 0 is the pixel center
+    static glm::vec2 sampleOffset(int index);
+
+    Framebuffer framebuffer;
+
+private:
+    ViewState cached{};
+    bool valid = false;
+    int currentStep = 0;
+    int samples = 0;
+    std::vector<HDRColor> sums;  // radiance per pixel, summed over all samples
+};
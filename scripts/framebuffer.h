@@ -0,0 +1,79 @@
+#pragma once
+#include <SDL.h>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "color.h"
+#include "hdrColor.h"
+#include "toneMap.h"
+
+// Color is laid out as r, g, b, a bytes, which is exactly SDL_PIXELFORMAT_RGBA32
+static_assert(sizeof(Color) == 4, "Color must stay a packed RGBA8 pixel");
+
+// The renderer shades into radiance and resolve() tone maps it into the 8-bit pixels
+// that are written to disk or uploaded to the window.
+struct Framebuffer {
+    int width;
+    int height;
+    std::vector<Color> pixels;
+    std::vector<HDRColor> radiance;
+
+    Framebuffer(int width, int height)
+            : width(width), height(height), pixels(static_cast<size_t>(width) * height),
+              radiance(static_cast<size_t>(width) * height) {}
+
+    void setPixel(int x, int y, const Color& color) {
+        pixels[static_cast<size_t>(y) * width + x] = color;
+    }
+
+    const Color& getPixel(int x, int y) const {
+        return pixels[static_cast<size_t>(y) * width + x];
+    }
+
+    void setRadiance(int x, int y, const HDRColor& color) {
+        radiance[static_cast<size_t>(y) * width + x] = color;
+    }
+
+    const HDRColor& getRadiance(int x, int y) const {
+        return radiance[static_cast<size_t>(y) * width + x];
+    }
+
+    // Tone maps the radiance of the [x0, x1) x [y0, y1) rectangle into pixels
+    void resolve(const ToneMapper& toneMapper, int x0, int y0, int x1, int y1) {
+        for (int y = y0; y < y1; y++) {
+            const size_t row = static_cast<size_t>(y) * width;
+            toneMapper.apply(&radiance[row + x0], &pixels[row + x0], static_cast<size_t>(x1 - x0));
+        }
+    }
+
+    void resolve(const ToneMapper& toneMapper) {
+        toneMapper.apply(radiance.data(), pixels.data(), pixels.size());
+    }
+
+    void clear(const Color& color = Color()) {
+        std::fill(pixels.begin(), pixels.end(), color);
+        std::fill(radiance.begin(), radiance.end(), HDRColor(color));
+    }
+
+    // Copy the whole frame into a SDL_TEXTUREACCESS_STREAMING texture in one go
+    bool upload(SDL_Texture* texture) const {
+        void* dst;
+        int pitch;
+        if (SDL_LockTexture(texture, nullptr, &dst, &pitch) != 0) {
+            return false;
+        }
+
+        const size_t rowBytes = static_cast<size_t>(width) * sizeof(Color);
+        if (pitch == static_cast<int>(rowBytes)) {
+            std::memcpy(dst, pixels.data(), rowBytes * height);
+        } else {
+            for (int y = 0; y < height; y++) {
+                std::memcpy(static_cast<Uint8*>(dst) + static_cast<size_t>(y) * pitch,
+                            &pixels[static_cast<size_t>(y) * width], rowBytes);
+            }
+        }
+
+        SDL_UnlockTexture(texture);
+        return true;
+    }
+};
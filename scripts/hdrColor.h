@@ -0,0 +1,38 @@
+#pragma once
+#include "color.h"
+
+// Linear float radiance used while shading. 1.0 is what 255 was in an 8-bit Color, but
+// nothing is clamped or quantized until the ToneMapper resolves the frame, so bright
+// highlights and scaled sums keep their value instead of wrapping around.
+struct alignas(16) HDRColor {
+    float r;
+    float g;
+    float b;
+    float a;
+
+    HDRColor() : r(0.0f), g(0.0f), b(0.0f), a(1.0f) {}
+
+    HDRColor(float red, float green, float blue, float alpha = 1.0f) : r(red), g(green), b(blue), a(alpha) {}
+
+    explicit HDRColor(const Color& color)
+            : r(color.r * (1.0f / 255.0f)), g(color.g * (1.0f / 255.0f)),
+              b(color.b * (1.0f / 255.0f)), a(color.a * (1.0f / 255.0f)) {}
+
+    HDRColor operator+(const HDRColor& other) const {
+        return HDRColor(r + other.r, g + other.g, b + other.b, a + other.a);
+    }
+
+    HDRColor& operator+=(const HDRColor& other) {
+        r += other.r;
+        g += other.g;
+        b += other.b;
+        a += other.a;
+        return *this;
+    }
+
+    HDRColor operator*(float factor) const {
+        return HDRColor(r * factor, g * factor, b * factor, a * factor);
+    }
+};
+
+static_assert(sizeof(HDRColor) == 16, "HDRColor must fill exactly one SSE register");
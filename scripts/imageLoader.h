@@ -4,12 +4,26 @@
 #include <stdexcept>
 #include <map>
 #include <string>
+#include <vector>
 
 #include "color.h"
 
+// Index of a loaded image, resolved once by name and then used for every texel lookup
+using TextureHandle = int;
+
+// Image converted to RGBA8 at load time and stored transposed, one column after another,
+// so walking down a wall column reads contiguous memory
+struct Texture {
+    int width = 0;
+    int height = 0;
+    std::vector<Color> texels;  // texel (x, y) is texels[x * height + y]
+};
+
 class ImageLoader {
 private:
     static std::map<std::string, SDL_Surface*> imageSurfaces;
+    static std::map<std::string, TextureHandle> handles;
+    static std::vector<Texture> textures;
 public:
     // Initialize SDL_image
     static void init() {
@@ -19,51 +33,84 @@ public:
         }
     }
 
-    // Load an image from a given path and store with a key
-    static void loadImage(const std::string& key, const char* path) {
+    // Load an image from a given path and store with a key. Loading a key again
+    // replaces the image but keeps its handle.
+    static TextureHandle loadImage(const std::string& key, const char* path) {
         SDL_Surface* newSurface = IMG_Load(path);
         if (!newSurface) {
             throw std::runtime_error("Unable to load image! SDL_image Error: " + std::string(IMG_GetError()));
         }
+        // Color is r, g, b, a bytes, the same layout as SDL_PIXELFORMAT_RGBA32
+        SDL_Surface* converted = SDL_ConvertSurfaceFormat(newSurface, SDL_PIXELFORMAT_RGBA32, 0);
+        if (!converted) {
+            SDL_FreeSurface(newSurface);
+            throw std::runtime_error("Unable to convert image to RGBA! SDL Error: " + std::string(SDL_GetError()));
+        }
+
+        Texture texture;
+        texture.width = converted->w;
+        texture.height = converted->h;
+        texture.texels.resize(static_cast<size_t>(converted->w) * converted->h);
+        for (int y = 0; y < converted->h; y++) {
+            const Color* row = reinterpret_cast<const Color*>(static_cast<Uint8*>(converted->pixels) +
+                                                              static_cast<size_t>(y) * converted->pitch);
+            for (int x = 0; x < converted->w; x++) {
+                texture.texels[static_cast<size_t>(x) * converted->h + y] = row[x];
+            }
+        }
+        SDL_FreeSurface(converted);
+
+        auto previous = imageSurfaces.find(key);
+        if (previous != imageSurfaces.end() && previous->second) {
+            SDL_FreeSurface(previous->second);
+        }
         imageSurfaces[key] = newSurface;
+
+        auto handle = handles.find(key);
+        if (handle != handles.end()) {
+            textures[handle->second] = std::move(texture);
+            return handle->second;
+        }
+        textures.push_back(std::move(texture));
+        handles[key] = static_cast<TextureHandle>(textures.size() - 1);
+        return handles[key];
     }
 
-    // Get the color of the pixel at (x, y) from an image with a specific key
-    static Color getPixelColor(const std::string& key, int x, int y) {
-        auto it = imageSurfaces.find(key);
-        if (it == imageSurfaces.end()) {
+    // Handle of a loaded image, look it up once and keep it
+    static TextureHandle getHandle(const std::string& key) {
+        TextureHandle handle = findHandle(key);
+        if (handle < 0) {
             throw std::runtime_error("Image key not found!");
         }
+        return handle;
+    }
 
-        SDL_Surface* targetSurface = it->second;
-        int bpp = targetSurface->format->BytesPerPixel;
-        Uint8 *p = (Uint8 *)targetSurface->pixels + y * targetSurface->pitch + x * bpp;
-
-        Uint32 pixelColor;
-        switch (bpp) {
-            case 1:
-                pixelColor = *p;
-                break;
-            case 2:
-                pixelColor = *(Uint16 *)p;
-                break;
-            case 3:
-                if (SDL_BYTEORDER == SDL_BIG_ENDIAN) {
-                    pixelColor = p[0] << 16 | p[1] << 8 | p[2];
-                } else {
-                    pixelColor = p[0] | p[1] << 8 | p[2] << 16;
-                }
-                break;
-            case 4:
-                pixelColor = *(Uint32 *)p;
-                break;
-            default:
-                throw std::runtime_error("Unknown format!");
-        }
+    // Same as getHandle, but -1 when nothing was loaded under key
+    static TextureHandle findHandle(const std::string& key) {
+        auto it = handles.find(key);
+        return it == handles.end() ? -1 : it->second;
+    }
+
+    static const Texture& getTexture(TextureHandle handle) {
+        return textures[handle];
+    }
 
-        SDL_Color color;
-        SDL_GetRGB(pixelColor, targetSurface->format, &color.r, &color.g, &color.b);
-        return Color{color.r, color.g, color.b};
+    // Texel (x, y) of a loaded image. No lookup, checks or format dispatch: handle must
+    // come from loadImage/getHandle and x, y must be inside the image.
+    static Color sample(TextureHandle handle, int x, int y) noexcept {
+        const Texture& texture = textures[handle];
+        return texture.texels[static_cast<size_t>(x) * texture.height + y];
+    }
+
+    // The height texels of column x, top to bottom
+    static const Color* column(TextureHandle handle, int x) noexcept {
+        const Texture& texture = textures[handle];
+        return &texture.texels[static_cast<size_t>(x) * texture.height];
+    }
+
+    // Get the color of the pixel at (x, y) from an image with a specific key
+    static Color getPixelColor(const std::string& key, int x, int y) {
+        return sample(getHandle(key), x, y);
     }
 
     static void render(SDL_Renderer* renderer, const std::string& key, int x, int y, int size = -1) {
@@ -101,8 +148,12 @@ public:
             }
         }
         imageSurfaces.clear();
+        handles.clear();
+        textures.clear();
         IMG_Quit();
     }
 };
 
-std::map<std::string, SDL_Surface*> ImageLoader::imageSurfaces;
\ No newline at end of file
+std::map<std::string, SDL_Surface*> ImageLoader::imageSurfaces;
+std::map<std::string, TextureHandle> ImageLoader::handles;
+std::vector<Texture> ImageLoader::textures;
\ No newline at end of file
@@ -0,0 +1,49 @@
+#include "imageWriter.h"
+#include <fstream>
+#include "SDL_image.h"
+
+namespace {
+    bool endsWith(const std::string& text, const std::string& suffix) {
+        return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    bool writePPM(const Framebuffer& framebuffer, const std::string& path) {
+        std::ofstream file(path, std::ios::binary);
+        if (!file) {
+            return false;
+        }
+        file << "P6\n" << framebuffer.width << " " << framebuffer.height << "\n255\n";
+
+        std::string row(static_cast<size_t>(framebuffer.width) * 3, '\0');
+        for (int y = 0; y < framebuffer.height; y++) {
+            for (int x = 0; x < framebuffer.width; x++) {
+                const Color& c = framebuffer.getPixel(x, y);
+                row[3 * x] = static_cast<char>(c.r);
+                row[3 * x + 1] = static_cast<char>(c.g);
+                row[3 * x + 2] = static_cast<char>(c.b);
+            }
+            file.write(row.data(), static_cast<std::streamsize>(row.size()));
+        }
+        return static_cast<bool>(file);
+    }
+
+    bool writePNG(const Framebuffer& framebuffer, const std::string& path) {
+        // Wraps the pixels without copying, RGBA32 matches the Color layout
+        SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormatFrom(
+                const_cast<Color*>(framebuffer.pixels.data()), framebuffer.width, framebuffer.height,
+                32, framebuffer.width * static_cast<int>(sizeof(Color)), SDL_PIXELFORMAT_RGBA32);
+        if (!surface) {
+            return false;
+        }
+        bool ok = IMG_SavePNG(surface, path.c_str()) == 0;
+        SDL_FreeSurface(surface);
+        return ok;
+    }
+}
+
+bool writeImage(const Framebuffer& framebuffer, const std::string& path) {
+    if (endsWith(path, ".png")) {
+        return writePNG(framebuffer, path);
+    }
+    return writePPM(framebuffer, path);
+}
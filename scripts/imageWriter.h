@@ -0,0 +1,6 @@
+#pragma once
+#include <string>
+#include "framebuffer.h"
+
+// Writes the framebuffer as PNG when the path ends in .png, binary PPM otherwise
+bool writeImage(const Framebuffer& framebuffer, const std::string& path);
@@ -1,10 +1,15 @@
 #pragma once
 
 #include "glm/glm.hpp"
+#include "material.h"
+
+// Offset for secondary ray origins, also the nearest distance an occluder can be at
+const float BIAS = 0.0001f;
 
 struct Intersect {
     bool isIntersecting = false;
     float dist = 0.0f;
     glm::vec3 point;
     glm::vec3 normal;
+    const Material* material = nullptr;  // set by primitives with per-hit materials, else the object's applies
 };
\ No newline at end of file
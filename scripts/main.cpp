@@ -1,7 +1,11 @@
 #include <SDL.h>
 #include <SDL_events.h>
 #include <SDL_render.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include <cstdlib>
+#include <memory>
 #include "glm/ext/quaternion_geometric.hpp"
 #include "glm/geometric.hpp"
 #include <string>
@@ -10,435 +14,398 @@
 #include "print.h"
 #include "skybox.h"
 #include "color.h"
-#include "intersect.h"
 #include "object.h"
-#include "sphere.h"
-#include "cube.h"
 #include "light.h"
 #include "camera.h"
+#include "framebuffer.h"
+#include "frameCache.h"
+#include "reprojection.h"
+#include "threadPool.h"
+#include "scene.h"
+#include "renderer.h"
+#include "sceneLoader.h"
+#include "sceneCache.h"
+#include "voxelGrid.h"
+#include "sceneOptimizer.h"
+#include "imageWriter.h"
 #include "glm/ext/matrix_transform.hpp"
 #include "SDL_image.h"
 
 const int SCREEN_WIDTH = 800;
 const int SCREEN_HEIGHT = 600;
-const float ASPECT_RATIO = static_cast<float>(SCREEN_WIDTH) / static_cast<float>(SCREEN_HEIGHT);
-const int MAX_RECURSION = 3;
-const float BIAS = 0.0001f;
 
 SDL_Renderer* renderer;
 std::vector<Object*> objects;
+Scene scene;
+std::unique_ptr<Scene> unoptimizedScene;  // the scene as written, kept by --optimize --headless to compare frame times
 Light light(glm::vec3(-20.0, -30, 30), 1.5f, Color(255, 255, 255));
 Camera camera(glm::vec3(0.0, 0.0, 15.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), 10.0f);
 Skybox skybox("../textures/minecraft.jpg");
+Renderer raytracer(scene, light, skybox);
+
+struct Options {
+    bool headless = false;
+    int width = SCREEN_WIDTH;
+    int height = SCREEN_HEIGHT;
+    unsigned threads = 0;
+    std::string output = "render.ppm";
+    std::string scenePath = "../scenes/wolf.scene";
+    bool sceneCache = true;  // load scenePath + ".bin" when it matches the text, write it otherwise
+    bool compileOnly = false;
+    bool optimize = false;  // drop duplicate and hidden primitives and merge boxes after loading
+    bool skyBilinear = false;
+    float voxelSize = 0.0f;  // > 0 moves the grid-aligned cubes of the scene into one voxel grid
+    bool hasEye = false;  // --eye/--target override the camera from the scene file
+    bool hasTarget = false;
+    glm::vec3 eye;
+    glm::vec3 target;
+    int previewStep = 8;  // first progressive pass traces one pixel per previewStep x previewStep block
+    int idleSamples = 1;  // samples per pixel to accumulate while nothing changes, 1 = none extra
+    bool reproject = false;  // reuse reprojected pixels of the last frame while the camera moves
+    float refreshPercent = 2.0f;  // with reproject, percent of the reused pixels traced again each frame
+    std::string statsPath;  // per-frame JSON lines, "-" for stdout, empty to disable
+};
 
 void point(glm::vec2 position, Color color) {
     SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
     SDL_RenderDrawPoint(renderer, position.x, position.y);
 }
 
-float castShadow(const glm::vec3& shadowOrigin, const glm::vec3& lightDir, Object* hitObject) {
-    for (auto& obj : objects) {
-        if (obj != hitObject) {
-            Intersect shadowIntersect = obj->rayIntersect(shadowOrigin, lightDir);
-            if (shadowIntersect.isIntersecting && shadowIntersect.dist > 0) {
-                float shadowRatio = shadowIntersect.dist / glm::length(light.position - shadowOrigin);
-                shadowRatio = glm::min(1.0f, shadowRatio);
-                return 1.0f - shadowRatio;
-            }
+// Old presentation path: one SDL_RenderDrawPoint per pixel, kept to compare frame times
+void drawPoints(const Framebuffer& framebuffer) {
+    for (int y = 0; y < framebuffer.height; y++) {
+        for (int x = 0; x < framebuffer.width; x++) {
+            point(glm::vec2(x, y), framebuffer.getPixel(x, y));
         }
     }
-    return 1.0f;
 }
 
-Color castRay(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, const short recursion = 0) {
-    float zBuffer = 99999;
-    Object* hitObject = nullptr;
-    Intersect intersect;
-
-    for (const auto& object : objects) {
-        Intersect i;
-        if (dynamic_cast<Cube*>(object) != nullptr) {
-            i = dynamic_cast<Cube*>(object)->rayIntersect(rayOrigin, rayDirection);
-        } else if (dynamic_cast<Sphere*>(object) != nullptr) {
-            i = dynamic_cast<Sphere*>(object)->rayIntersect(rayOrigin, rayDirection);
-        }
-        if (i.isIntersecting && i.dist < zBuffer) {
-            zBuffer = i.dist;
-            hitObject = object;
-            intersect = i;
+bool parseVec3(const char* text, glm::vec3& v) {
+    return std::sscanf(text, "%f,%f,%f", &v.x, &v.y, &v.z) == 3;
+}
+
+void printUsage(const char* program) {
+    print("usage:", program, "[options]");
+    print("  --threads N        render threads, 0 = one per hardware thread");
+    print("  --no-packets       trace primary and shadow rays one at a time");
+    print("  --width W          image width");
+    print("  --height H         image height");
+    print("  --scene path       scene file, ../scenes/wolf.scene by default");
+    print("  --no-scene-cache   always parse the scene text and build the BVH");
+    print("  --compile-scene    write the compiled scene next to the scene file and exit");
+    print("  --sky-bilinear     filter the skybox cube map bilinearly instead of nearest texel");
+    print("  --optimize         remove duplicate and hidden primitives and merge boxes after loading");
+    print("  --voxelize S       trace cubes aligned to an S sized lattice as one voxel grid, skips the scene cache");
+    print("  --eye x,y,z        camera position");
+    print("  --target x,y,z     camera target");
+    print("  --depth N          maximum recursion depth");
+    print("  --tonemap op       clamp (default), reinhard or aces");
+    print("  --exposure E       radiance scale before tone mapping, 1 by default");
+    print("  --gamma G          output gamma, 1 keeps the scene colors as authored");
+    print("  --headless         render one frame without a window and exit");
+    print("  --out path         headless output, .png or .ppm");
+    print("  --preview-step N   coarsest progressive pass after a change, power of two up to 16, 1 = off");
+    print("  --refine-idle N    average up to N jittered samples per pixel while the view is still");
+    print("  --reproject        reuse last frame pixels while the camera moves instead of progressive passes");
+    print("  --refresh P        percent of reused pixels traced again every frame with --reproject");
+    print("  --stats path       append one JSON line of ray counters per frame, - for stdout");
+}
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--threads" && hasValue) {
+            options.threads = static_cast<unsigned>(std::max(0, std::atoi(argv[++i])));
+        } else if (arg == "--no-packets") {
+            raytracer.settings.usePackets = false;
+        } else if (arg == "--width" && hasValue) {
+            options.width = std::atoi(argv[++i]);
+        } else if (arg == "--height" && hasValue) {
+            options.height = std::atoi(argv[++i]);
+        } else if (arg == "--eye" && hasValue) {
+            if (!parseVec3(argv[++i], options.eye)) {
+                return false;
+            }
+            options.hasEye = true;
+        } else if (arg == "--target" && hasValue) {
+            if (!parseVec3(argv[++i], options.target)) {
+                return false;
+            }
+            options.hasTarget = true;
+        } else if (arg == "--scene" && hasValue) {
+            options.scenePath = argv[++i];
+        } else if (arg == "--no-scene-cache") {
+            options.sceneCache = false;
+        } else if (arg == "--compile-scene") {
+            options.compileOnly = true;
+        } else if (arg == "--sky-bilinear") {
+            options.skyBilinear = true;
+        } else if (arg == "--optimize") {
+            options.optimize = true;
+        } else if (arg == "--voxelize" && hasValue) {
+            options.voxelSize = static_cast<float>(std::atof(argv[++i]));
+            if (options.voxelSize <= 0.0f) {
+                return false;
+            }
+        } else if (arg == "--depth" && hasValue) {
+            raytracer.settings.maxRecursion = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--tonemap" && hasValue) {
+            std::string op = argv[++i];
+            if (op == "clamp") {
+                raytracer.settings.toneMap.op = ToneMapOperator::Clamp;
+            } else if (op == "reinhard") {
+                raytracer.settings.toneMap.op = ToneMapOperator::Reinhard;
+            } else if (op == "aces") {
+                raytracer.settings.toneMap.op = ToneMapOperator::ACES;
+            } else {
+                return false;
+            }
+        } else if (arg == "--exposure" && hasValue) {
+            raytracer.settings.toneMap.exposure = std::max(0.0f, static_cast<float>(std::atof(argv[++i])));
+        } else if (arg == "--gamma" && hasValue) {
+            raytracer.settings.toneMap.gamma = static_cast<float>(std::atof(argv[++i]));
+            if (raytracer.settings.toneMap.gamma <= 0.0f) {
+                return false;
+            }
+        } else if (arg == "--headless") {
+            options.headless = true;
+        } else if (arg == "--out" && hasValue) {
+            options.output = argv[++i];
+        } else if (arg == "--preview-step" && hasValue) {
+            options.previewStep = std::atoi(argv[++i]);
+            if (options.previewStep < 1 || options.previewStep > Renderer::TILE_SIZE ||
+                (options.previewStep & (options.previewStep - 1)) != 0) {
+                return false;
+            }
+        } else if (arg == "--refine-idle" && hasValue) {
+            options.idleSamples = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--reproject") {
+            options.reproject = true;
+        } else if (arg == "--refresh" && hasValue) {
+            options.refreshPercent = std::clamp(static_cast<float>(std::atof(argv[++i])), 0.0f, 100.0f);
+        } else if (arg == "--stats" && hasValue) {
+            options.statsPath = argv[++i];
+        } else {
+            return false;
         }
     }
+    return options.width > 0 && options.height > 0;
+}
 
-    if (!intersect.isIntersecting || recursion == MAX_RECURSION) {
-        return skybox.getColor(rayDirection);  // Sky color
+FILE* openStats(const Options& options) {
+    if (options.statsPath.empty()) {
+        return nullptr;
     }
+    if (options.statsPath == "-") {
+        return stdout;
+    }
+    FILE* file = std::fopen(options.statsPath.c_str(), "a");
+    if (!file) {
+        std::fprintf(stderr, "could not open %s, stats disabled\n", options.statsPath.c_str());
+    }
+    return file;
+}
 
+// reuse < 0 leaves the reprojection reuse ratio out of the line
+void writeStats(FILE* file, int frame, double renderMs, double reuse = -1.0) {
+    if (!file) {
+        return;
+    }
+    char reuseField[48] = "";
+    if (reuse >= 0.0) {
+        std::snprintf(reuseField, sizeof(reuseField), ", \"reuse\": %.4f", reuse);
+    }
+    std::fprintf(file, "{\"frame\": %d, \"render_ms\": %.3f%s, \"stats\": %s}\n",
+                 frame, renderMs, reuseField, raytracer.getStats().toJson().c_str());
+    std::fflush(file);
+}
 
-    glm::vec3 lightDir = glm::normalize(light.position - intersect.point);
-    glm::vec3 viewDir = glm::normalize(rayOrigin - intersect.point);
-    glm::vec3 reflectDir = glm::reflect(-lightDir, intersect.normal);
-
-    float shadowIntensity = castShadow(intersect.point, lightDir, hitObject);
+// Renders a single frame into memory and writes it to disk, no window or SDL renderer involved
+int renderHeadless(const Options& options, ThreadPool& pool) {
+    FrameCache cache(options.width, options.height);
 
-    float diffuseLightIntensity = std::max(0.0f, glm::dot(intersect.normal, lightDir));
-    float specReflection = glm::dot(viewDir, reflectDir);
+    auto start = std::chrono::high_resolution_clock::now();
+    raytracer.render(cache.framebuffer, camera, pool);
+    auto end = std::chrono::high_resolution_clock::now();
 
-    Material mat = hitObject->material;
+    double seconds = std::chrono::duration<double>(end - start).count();
+    uint64_t rays = raytracer.getStats().bvhRays;
+    std::printf("rendered %dx%d in %.2f ms, %llu rays, %.2f Mrays/s\n",
+                options.width, options.height, seconds * 1000.0,
+                static_cast<unsigned long long>(rays), rays / seconds / 1e6);
 
-    float specLightIntensity = std::pow(std::max(0.0f, glm::dot(viewDir, reflectDir)), mat.specularCoefficient);
+    FILE* stats = openStats(options);
+    writeStats(stats, 0, seconds * 1000.0);
+    if (stats && stats != stdout) {
+        std::fclose(stats);
+    }
 
-    Color reflectedColor(0.0f, 0.0f, 0.0f);
-    if (mat.reflectivity > 0) {
-        glm::vec3 origin = intersect.point + intersect.normal * BIAS;
-        reflectedColor = castRay(origin, reflectDir, recursion + 1);
+    if (unoptimizedScene) {
+        // The same frame before and after --optimize, each timed after a warm-up render
+        Renderer unoptimized(*unoptimizedScene, light, skybox);
+        unoptimized.settings = raytracer.settings;
+        const Renderer* renderers[2] = {&unoptimized, &raytracer};
+        double frameMs[2];
+        Framebuffer frame(options.width, options.height);
+        for (int i = 0; i < 2; i++) {
+            renderers[i]->render(frame, camera, pool);
+            auto frameStart = std::chrono::high_resolution_clock::now();
+            renderers[i]->render(frame, camera, pool);
+            auto frameEnd = std::chrono::high_resolution_clock::now();
+            frameMs[i] = std::chrono::duration<double, std::milli>(frameEnd - frameStart).count();
+        }
+        print("optimize: frame", frameMs[0], "ms before,", frameMs[1], "ms after");
     }
 
-    Color refractedColor(0.0f, 0.0f, 0.0f);
-    if (mat.transparency > 0) {
-        glm::vec3 origin = intersect.point - intersect.normal * BIAS;
-        glm::vec3 refractDir = glm::refract(rayDirection, intersect.normal, mat.refractionIndex);
-        refractedColor = castRay(origin, refractDir, recursion + 1);
+    if (options.idleSamples > 1) {
+        cache.store(ViewState::capture(camera, light, scene, raytracer.settings));
+        Framebuffer sample(options.width, options.height);
+        while (cache.sampleCount() < options.idleSamples) {
+            raytracer.render(sample, camera, pool, FrameCache::sampleOffset(cache.sampleCount()));
+            cache.accumulate(sample);
+        }
+        raytracer.resolve(cache.framebuffer, pool);
+        print("accumulated", cache.sampleCount(), "samples per pixel");
     }
 
-    Color diffuseLight = mat.diffuse * light.intensity * diffuseLightIntensity * mat.albedo * shadowIntensity;
-    Color specularLight = light.color * light.intensity * specLightIntensity * mat.specularAlbedo * shadowIntensity;
-    Color color = (diffuseLight + specularLight) * (1.0f - mat.reflectivity - mat.transparency) + reflectedColor * mat.reflectivity + refractedColor * mat.transparency;
-    return color;
+    if (!writeImage(cache.framebuffer, options.output)) {
+        std::fprintf(stderr, "could not write %s\n", options.output.c_str());
+        return 1;
+    }
+    print("wrote", options.output);
+    return 0;
 }
 
-void setUp() {
-    Material rubber = {
-            Color(155,155,155),   // diffuse
-            0.9,
-            0.1,
-            10.0f,
-            0.0f,
-            0.0f
-    };
-
-    Material graySecond = {
-            Color(145,145,145),   // diffuse
-            0.9,
-            0.1,
-            10.0f,
-            0.0f,
-            0.0f
-    };
-
-    Material grayThird = {
-            Color(135,135,135),   // diffuse
-            0.9,
-            0.1,
-            10.0f,
-            0.0f,
-            0.0f
-    };
-
-    Material grayFourth = {
-            Color(125,125,125),   // diffuse
-            0.9,
-            0.1,
-            10.0f,
-            0.0f,
-            0.0f
-    };
-
-    Material diamond = {
-            Color(0,0,170),   // diffuse
-            0.5,
-            0.1,
-            10.0f,
-            0.7f,
-            0.4f
-    };
-
-    Material carbon = {
-            Color(10,10,10),   // diffuse
-            0.9,
-            0.1,
-            10.0f,
-            0.0f,
-            0.0f
-    };
-
-    Material white = {
-            Color(170,170,170),   // diffuse
-            0.9,
-            0.1,
-            10.0f,
-            0.0f,
-            0.0f
-    };
-
-    Material red = {
-            Color(255,0,0),   // diffuse
-            0.9,
-            0.1,
-            10.0f,
-            0.0f,
-            0.0f
-    };
-
-
-    Material brown = {
-            Color(108,94,83),   // diffuse
-            0.9,
-            0.1,
-            10.0f,
-            0.0f,
-            0.0f
-    };
-
-    Material brownWhite = {
-            Color(140, 130, 120),   // diffuse
-            0.9,
-            0.1,
-            10.0f,
-            0.0f,
-            0.0f
-    };
-
-    Material brownSecond = {
-            Color(103,82,65),   // diffuse
-            0.9,
-            0.1,
-            10.0f,
-            0.0f,
-            0.0f
-    };
-
-    Material brownThird = {
-            Color(113,92,75),   // diffuse
-            0.9,
-            0.1,
-            10.0f,
-            0.0f,
-            0.0f
-    };
-
-    Material ivory = {
-            Color(100, 100, 80),
-            0.5,
-            0.5,
-            50.0f,
-            0.4f,
-            0.0f
-    };
-
-    Material mirror = {
-            Color(255, 255, 255),
-            0.0f,
-            10.0f,
-            1425.0f,
-            0.9f,
-            0.0f
-    };
-
-    Material glass = {
-            Color(255, 255, 255),
-            0.0f,
-            10.0f,
-            1425.0f,
-            0.2f,
-            1.0f,
-    };
-
-    //Face
-    objects.push_back(new Cube(glm::vec3(-1.0f, -1.0f, -0.5f), glm::vec3(1.0f, 1.0f, 0.4f), rubber));
-    //----BeardRight
-    //--piramid
-    objects.push_back(new Cube(glm::vec3(0.7f, -1.001f, -0.2f), glm::vec3(1.001f, -0.7f, 0.41f), brown));
-    objects.push_back(new Cube(glm::vec3(0.7f, -0.7f, 0.1f), glm::vec3(1.001f, -0.4f, 0.4f), brown));objects.push_back(new Cube(glm::vec3(0.7f, -0.7f, 0.1f), glm::vec3(1.001f, -0.4f, 0.4f), brown));
-    //--pixels
-    objects.push_back(new Cube(glm::vec3(0.7f, -0.7f, 0.1f), glm::vec3(1.0f, -0.4f, 0.41f), brownSecond));
-    objects.push_back(new Cube(glm::vec3(0.7f, -0.4f, 0.1f), glm::vec3(1.0f, -0.1f, 0.41f), brownWhite));
-    objects.push_back(new Cube(glm::vec3(0.4f, -0.7f, 0.1f), glm::vec3(0.7f, -0.4f, 0.41f), brownWhite));
-    objects.push_back(new Cube(glm::vec3(0.4f, -0.4f, 0.1f), glm::vec3(0.7f, -0.1f, 0.41f), brownSecond));
-    objects.push_back(new Cube(glm::vec3(0.4f, -1.0f, 0.1f), glm::vec3(0.7f, -0.7f, 0.41f), brownThird));
-
-    //----BeardLeft
-    //--piramid
-    objects.push_back(new Cube(glm::vec3(-1.0001f, -1.001f, -0.2f), glm::vec3(-0.7f, -0.7f, 0.41f), brown));
-    objects.push_back(new Cube(glm::vec3(-1.001f, -0.7f, 0.1f), glm::vec3(-0.7f, -0.4f, 0.4f), brown));objects.push_back(new Cube(glm::vec3(0.7f, -0.7f, 0.1f), glm::vec3(1.001f, -0.4f, 0.4f), brown));
-    //--pixels
-    objects.push_back(new Cube(glm::vec3(-1.0f, -0.7f, 0.1f), glm::vec3(-0.7f, -0.4f, 0.41f), brownSecond));
-    objects.push_back(new Cube(glm::vec3(-1.0f, -0.4f, 0.1f), glm::vec3(-0.7f, -0.1f, 0.41f), brownWhite));
-    objects.push_back(new Cube(glm::vec3(-0.7f, -0.7f, 0.1f), glm::vec3(-0.4f, -0.4f, 0.41f), brownWhite));
-    objects.push_back(new Cube(glm::vec3(-0.7f, -0.4f, 0.1f), glm::vec3(-0.4f, -0.1f, 0.41f), brownSecond));
-    objects.push_back(new Cube(glm::vec3(-0.7f, -1.0f, 0.1f), glm::vec3(-0.4f, -0.7f, 0.41f), brownThird));
-
-    //--eyebrows right
-    objects.push_back(new Cube(glm::vec3(0.7f, 0.7f, 0.1f), glm::vec3(1.0f, 1.0f, 0.401f), grayThird));
-    objects.push_back(new Cube(glm::vec3(0.4f, 0.7f, 0.1f), glm::vec3(0.7f, 1.0f, 0.401f), graySecond));
-
-    objects.push_back(new Cube(glm::vec3(0.7f, 0.4f, 0.1f), glm::vec3(1.0f, 0.7f, 0.401f), graySecond));
-    objects.push_back(new Cube(glm::vec3(0.4f, 0.4f, 0.1f), glm::vec3(0.7f, 0.7f, 0.401f), grayThird));
-
-    //--eyebrows left
-    objects.push_back(new Cube(glm::vec3(-1.0f, 0.7f, 0.1f), glm::vec3(-0.7f, 1.0f, 0.401f), grayThird));
-    objects.push_back(new Cube(glm::vec3(-0.7f, 0.7f, 0.1f), glm::vec3(-0.4f, 1.0f, 0.401f), graySecond));
-
-    objects.push_back(new Cube(glm::vec3(-1.0f, 0.4f, 0.1f), glm::vec3(-0.7f, 0.7f, 0.401f), graySecond));
-    objects.push_back(new Cube(glm::vec3(-0.7f, 0.4f, 0.1f), glm::vec3(-0.4f, 0.7f, 0.401f), grayThird));
-    objects.push_back(new Cube(glm::vec3(-0.4f, 0.4f, 0.1f), glm::vec3(0.4f, 0.7f, 0.401f), graySecond));
-
-    //Eyes
-    //----Left
-    objects.push_back(new Cube(glm::vec3(-0.6f, 0.0f, 0.4f), glm::vec3(-0.3f, 0.3f, 0.41f), carbon));
-    objects.push_back(new Cube(glm::vec3(-0.9f, 0.0f, 0.4f), glm::vec3(-0.6f, 0.3f, 0.41f), white));
-    //---Between
-    objects.push_back(new Cube(glm::vec3(-0.3f, 0.0f, 0.4f), glm::vec3(0.3f, 0.3f, 0.41f), brown));
-    //----Right
-    objects.push_back(new Cube(glm::vec3(0.3f, 0.0f, 0.4f), glm::vec3(0.6f, 0.3f, 0.41f), carbon));
-    objects.push_back(new Cube(glm::vec3(0.6f, 0.0f, 0.4f), glm::vec3(0.9f, 0.3f, 0.41f), white));
-
-    //Snout
-    objects.push_back(new Cube(glm::vec3(-0.45f, -1.0f, 0.4f), glm::vec3(0.45f, 0.0f, 1.3f), brownWhite));
-    //----OnSnout
-    objects.push_back(new Cube(glm::vec3(-0.45f, 0.0f, 0.4f), glm::vec3(0.45f, 0.001f, 1.3f), brown));
-    //----line
-    objects.push_back(new Cube(glm::vec3(-0.46f, -1.0f, 0.4f), glm::vec3(0.46f, -0.7f, 1.32f), carbon));
-    //----nose
-    objects.push_back(new Cube(glm::vec3(-0.15f, -0.29f, 1.01f), glm::vec3(0.15f, 0.01f, 1.31f), carbon));
-    //----mustache
-    objects.push_back(new Cube(glm::vec3(-0.46f, -0.7f, 0.4f), glm::vec3(0.46f, -0.4f, 1.0f), brown));
-    objects.push_back(new Cube(glm::vec3(-0.46f, -0.4f, 0.4f), glm::vec3(0.46f, -0.1f, 0.7f), brown));
-
-    //Ears
-    objects.push_back(new Cube(glm::vec3(-1.0f, 1.0f, -0.5f), glm::vec3(-0.3f, 1.6f, -0.2f), rubber));
-    objects.push_back(new Cube(glm::vec3(-1.01f, 1.0f, -0.47f), glm::vec3(-0.299f, 1.601f, -0.23f), carbon));
-
-    objects.push_back(new Cube(glm::vec3(0.3f, 1.0f, -0.5f), glm::vec3(1.0f, 1.6f, -0.2f), rubber));
-    objects.push_back(new Cube(glm::vec3(0.299f, 1.0f, -0.47f), glm::vec3(1.01f, 1.601f, -0.23f), carbon));
-
-    //Body-front
-    objects.push_back(new Cube(glm::vec3(-1.3f, -1.3f, -2.5f), glm::vec3(1.3f, 1.3f, -0.5f), rubber));
-    //--necklace
-    objects.push_back(new Cube(glm::vec3(-1.3f, -1.3f, -0.5f), glm::vec3(1.3f, 1.3f, -0.499f), red));
-    objects.push_back(new Cube(glm::vec3(-0.25f, -1.8f, -0.5f), glm::vec3(0.25f, -1.3f, -1.0f), diamond));
-    //--pixels
-    objects.push_back(new Cube(glm::vec3(-1.301f, 1.0f, -2.5f), glm::vec3(1.301f, 1.3f, -2.2f), graySecond));
-    objects.push_back(new Cube(glm::vec3(-1.301f, 0.7f, -2.5f), glm::vec3(1.301f, 1.0f, -2.2f), grayThird));
-    objects.push_back(new Cube(glm::vec3(-1.301f, 0.7f, -2.2f), glm::vec3(1.301f, 1.0f, -1.1f), graySecond));
-    objects.push_back(new Cube(glm::vec3(-1.301f, 0.4f, -2.5f), glm::vec3(1.301f, 0.7f, -2.2f), grayFourth));
-    objects.push_back(new Cube(glm::vec3(-1.301f, 0.4f, -2.2f), glm::vec3(1.301f, 0.7f, -1.9f), grayThird));
-    objects.push_back(new Cube(glm::vec3(-1.301f, 0.4f, -2.5f), glm::vec3(1.301f, 0.1f, -2.2f), grayThird));
-
-    objects.push_back(new Cube(glm::vec3(-1.302f, 1.3f, -0.8f), glm::vec3(1.302f, 1.0f, -0.5f), grayThird));
-    objects.push_back(new Cube(glm::vec3(-1.302f, 1.0f, -1.1f), glm::vec3(1.302f, 0.7f, -0.8f), grayFourth));
-    objects.push_back(new Cube(glm::vec3(-1.301f, 1.3f, -0.8f), glm::vec3(1.301f, -0.4f, -0.5f), graySecond));
-
-    objects.push_back(new Cube(glm::vec3(-1.301f, -1.0f, -2.2f), glm::vec3(1.301f, -0.7f, -0.9f), graySecond));
-    objects.push_back(new Cube(glm::vec3(-1.302f, -1.0f, -1.2f), glm::vec3(1.302f, -0.7f, -0.9f), grayFourth));
-    objects.push_back(new Cube(glm::vec3(-1.301f, -1.0f, -0.9f), glm::vec3(1.301f, -0.7f, -0.6f), grayThird));
-    objects.push_back(new Cube(glm::vec3(-1.301f, -0.7f, -1.2f), glm::vec3(1.301f, -0.4f, -0.9f), grayThird));
-    objects.push_back(new Cube(glm::vec3(-1.301f, -1.3f, -1.2f), glm::vec3(1.301f, -1.0f, -0.9f), grayThird));
-
-    objects.push_back(new Cube(glm::vec3(-1.301f, -1.3f, -2.5f), glm::vec3(1.301f, -0.7f, -2.2f), brownWhite));
-    objects.push_back(new Cube(glm::vec3(-1.301f, -1.3f, -2.2f), glm::vec3(1.301f, -1.0f, -1.9f), brownWhite));
-
-    //pixelsOnBody
-
-    //Body-back
-    objects.push_back(new Cube(glm::vec3(-1.0f, -1.3f, -5.5f), glm::vec3(1.0f, 0.85f, -2.5f), rubber));
-    objects.push_back(new Cube(glm::vec3(-1.001f, 0.5f, -5.5f), glm::vec3(1.001f, 0.85f, -5.3f), grayFourth));
-    objects.push_back(new Cube(glm::vec3(-1.001f, 0.5f, -5.3f), glm::vec3(1.001f, 0.85f, -4.0f), graySecond));
-    objects.push_back(new Cube(glm::vec3(-1.001f, 0.5f, -5.5f), glm::vec3(1.001f, -0.1f, -5.3f), graySecond));
-
-    objects.push_back(new Cube(glm::vec3(-1.001f, -1.3f, -2.5f), glm::vec3(1.001f, -1.0f, -5.0f), grayThird));
-    objects.push_back(new Cube(glm::vec3(-1.001f, -1.0f, -2.5f), glm::vec3(1.001f, -0.7f, -4.4f), grayThird));
-    objects.push_back(new Cube(glm::vec3(-1.001f, -1.0f, -2.5f), glm::vec3(1.001f, 0.5f, -2.8f), grayThird));
-    objects.push_back(new Cube(glm::vec3(-1.002f, -1.3f, -2.5f), glm::vec3(1.002f, -1.0f, -2.8f), grayFourth));
-
-    objects.push_back(new Cube(glm::vec3(-1.001f, 0.0f, -3.5f), glm::vec3(1.001f, 0.3f, -5.0f), graySecond));
-    objects.push_back(new Cube(glm::vec3(-1.001f, -0.3f, -2.8f), glm::vec3(1.001f, -0.6f, -4.0f), graySecond));
-
-
-    //Arms
-    //----Front-right
-    objects.push_back(new Cube(glm::vec3(0.15f, -1.3f, -0.95f), glm::vec3(0.85f, -3.5f, -1.65f), rubber));
-    objects.push_back(new Cube(glm::vec3(0.15f, -2.6f, -0.949f), glm::vec3(0.85f, -3.2f, -1.651f), brownThird));
-
-    //----Front-left
-    objects.push_back(new Cube(glm::vec3(-0.15f, -1.3f, -0.95f), glm::vec3(-0.85f, -3.5f, -1.65f), rubber));
-    objects.push_back(new Cube(glm::vec3(-0.15f, -2.6f, -0.949f), glm::vec3(-0.85f, -3.2f, -0.95f), brownThird));
-    objects.push_back(new Cube(glm::vec3(-0.149f, -2.9f, -1.30f), glm::vec3(-0.851f, -3.2f, -1.65f), brownThird));
-    objects.push_back(new Cube(glm::vec3(-0.149f, -2.9f, -0.95f), glm::vec3(-0.851f, -3.2f, -1.30f), brownWhite));
-    objects.push_back(new Cube(glm::vec3(-0.149f, -2.9f, -1.30f), glm::vec3(-0.851f, -3.2f, -1.65f), brownWhite));
-    objects.push_back(new Cube(glm::vec3(-0.149f, -2.6f, -1.30f), glm::vec3(-0.851f, -2.9f, -1.65f), brownWhite));
-    objects.push_back(new Cube(glm::vec3(-0.149f, -2.6f, -0.95f), glm::vec3(-0.851f, -2.9f, -1.30f), brownThird));
-
-    //objects.push_back(new Cube(glm::vec3(-0.151f, -2.6f, -0.95f), glm::vec3(-0.851f, -2.9f, -1.25f), brownWhite));
-
-    //----Back-right
-    objects.push_back(new Cube(glm::vec3(0.15f, -1.3f, -5.05f), glm::vec3(0.85f, -3.5f, -4.35f), rubber));
-    objects.push_back(new Cube(glm::vec3(0.15f, -2.6f, -5.051f), glm::vec3(0.85f, -2.9f, -4.349f), brownThird));
-    objects.push_back(new Cube(glm::vec3(0.15f, -2.9f, -5.051f), glm::vec3(0.50f, -3.2f, -4.349f), brownThird));
-
-    objects.push_back(new Cube(glm::vec3(0.149f, -2.9f, -5.05f), glm::vec3(0.851f, -3.2f, -4.70f), brownThird));
-    objects.push_back(new Cube(glm::vec3(0.149f, -2.9f, -4.70f), glm::vec3(0.851f, -3.2f, -4.35f), brownWhite));
-
-    objects.push_back(new Cube(glm::vec3(0.149f, -2.6f, -5.05f), glm::vec3(0.851f, -2.9f, -4.70f), brownWhite));
-    objects.push_back(new Cube(glm::vec3(0.149f, -2.6f, -4.70f), glm::vec3(0.851f, -2.9f, -4.35f), brownThird));
-
-    //----Back-left
-    objects.push_back(new Cube(glm::vec3(-0.15f, -1.3f, -5.05f), glm::vec3(-0.85f, -3.5f, -4.35f), rubber));
-    objects.push_back(new Cube(glm::vec3(-0.15f, -2.6f, -5.051f), glm::vec3(-0.85f, -2.9f, -4.349f), brownThird));
-    objects.push_back(new Cube(glm::vec3(-0.85f, -2.9f, -5.051f), glm::vec3(-0.50f, -3.2f, -4.349f), brownThird));
-
-    objects.push_back(new Cube(glm::vec3(-0.149f, -2.9f, -5.05f), glm::vec3(-0.851f, -3.2f, -4.70f), brownThird));
-    objects.push_back(new Cube(glm::vec3(-0.149f, -2.9f, -4.70f), glm::vec3(-0.851f, -3.2f, -4.35f), brownWhite));
-
-    objects.push_back(new Cube(glm::vec3(-0.149f, -2.6f, -5.05f), glm::vec3(-0.851f, -2.9f, -4.70f), brownWhite));
-    objects.push_back(new Cube(glm::vec3(-0.149f, -2.6f, -4.70f), glm::vec3(-0.851f, -2.9f, -4.35f), brownThird));
-
-    //tail
-    objects.push_back(new Cube(glm::vec3(-0.35f, 0.0f, -5.5f), glm::vec3(0.35f, 0.70f, -8.5f), rubber));
-
-
-    //objects.push_back(new Cube(glm::vec3(1.0f, 1.0f, -3.0f), glm::vec3(1.5f, 1.5f, 1.5f), mirror));
-    //objects.push_back(new Sphere(glm::vec3(-1.0f, 0.0f, -4.0f), 1.0f, ivory));
-    //objects.push_back(new Cube(glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(1.0f, 1.0f, 1.0f), mirror));
-    //objects.push_back(new Cube(glm::vec3(0.0f, 1.0f, -3.0f), 1.0f, glass));
+void handleEvent(const SDL_Event& event, bool& running, bool& useDrawPoints) {
+    if (event.type == SDL_QUIT) {
+        running = false;
+    }
 
+    if (event.type == SDL_KEYDOWN) {
+        switch(event.key.keysym.sym) {
+            case SDLK_UP:
+                print("up");
+                camera.rotate(0.0f, 1.0f);
+                break;
+            case SDLK_DOWN:
+                print("down");
+                camera.rotate(0.0f, -1.0f);
+                break;
+            case SDLK_LEFT:
+                print("left");
+                camera.rotate(-1.0f, 0.0f);
+                break;
+            case SDLK_RIGHT:
+                print("right");
+                camera.rotate(1.0f, 0.0f);
+                break;
+            case SDLK_w:
+                camera.move(1.0f);
+                break;
+            case SDLK_s:
+                camera.move(-1.0f);
+                break;
+            case SDLK_p:
+                useDrawPoints = !useDrawPoints;
+                print(useDrawPoints ? "present: draw points" : "present: streaming texture");
+                break;
+        }
+    }
 }
 
-void render() {
-    float fov = 3.1415/3;
-    for (int y = 0; y < SCREEN_HEIGHT; y++) {
-        for (int x = 0; x < SCREEN_WIDTH; x++) {
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
 
-            float random_value = static_cast<float>(std::rand())/static_cast<float>(RAND_MAX);
-            if (random_value < 0.0 ) {
-                continue;
+    ThreadPool pool(options.threads);
+    print("render threads:", pool.size());
+
+    // Camera, light and skybox keep their defaults unless the scene file sets them
+    try {
+        auto loadStart = std::chrono::high_resolution_clock::now();
+        const std::string cachePath = options.scenePath + ".bin";
+        uint64_t sourceHash = 0;
+        // The cache holds the scene as written, so voxelizing always starts from the text
+        bool hashed = options.voxelSize <= 0.0f && hashFile(options.scenePath, sourceHash);
+        if (options.optimize) {
+            sourceHash ^= 0x9e3779b97f4a7c15ull;  // an optimized compile is a different scene
+        }
+        SceneDescription description;
+        if (hashed && options.sceneCache && !options.compileOnly &&
+            loadCompiledScene(cachePath, sourceHash, scene, description)) {
+            auto loadEnd = std::chrono::high_resolution_clock::now();
+            print("scene:", cachePath, "- mapped in",
+                  std::chrono::duration<double, std::milli>(loadEnd - loadStart).count(), "ms");
+        } else {
+            description = loadScene(options.scenePath);
+            auto loadEnd = std::chrono::high_resolution_clock::now();
+            print("scene:", options.scenePath, "-", description.objects.size(), "objects loaded in",
+                  std::chrono::duration<double, std::milli>(loadEnd - loadStart).count(), "ms");
+
+            objects = std::move(description.objects);
+            if (options.optimize && options.headless && options.voxelSize <= 0.0f) {
+                unoptimizedScene = std::make_unique<Scene>();
+                unoptimizedScene->build(objects);
             }
+            if (options.optimize) {
+                auto optimizeStart = std::chrono::high_resolution_clock::now();
+                OptimizeReport report = optimizeScene(objects);
+                auto optimizeEnd = std::chrono::high_resolution_clock::now();
+                print("optimize:", report.before, "->", report.after, "objects,", report.duplicates, "duplicates,",
+                      report.merged, "merged,", report.enclosed, "enclosed, in",
+                      std::chrono::duration<double, std::milli>(optimizeEnd - optimizeStart).count(), "ms");
+            }
+            if (options.voxelSize > 0.0f) {
+                if (VoxelGrid* grid = voxelizeCubes(objects, glm::vec3(options.voxelSize))) {
+                    print("voxels:", grid->voxelCount(), "in", grid->brickCount(), "bricks,",
+                          objects.size() - 1, "objects left");
+                }
+            }
+            scene.build(objects);
+            print("bvh:", scene.primitives.cubes.size(), "cubes,", scene.primitives.spheres.size(), "spheres,",
+                  scene.bvh.nodeCount(), "nodes, built in", scene.bvh.getBuildTimeMs(), "ms");
+
+            if (hashed && (options.sceneCache || options.compileOnly)) {
+                if (writeCompiledScene(cachePath, sourceHash, description, scene)) {
+                    print("scene: compiled to", cachePath);
+                } else {
+                    std::fprintf(stderr, "could not write %s\n", cachePath.c_str());
+                }
+            }
+        }
+        if (options.compileOnly) {
+            return 0;
+        }
 
-
-
-            float screenX = (2.0f * (x + 0.5f)) / SCREEN_WIDTH - 1.0f;
-            float screenY = -(2.0f * (y + 0.5f)) / SCREEN_HEIGHT + 1.0f;
-            screenX *= ASPECT_RATIO;
-            screenX *= tan(fov/2.0f);
-            screenY *= tan(fov/2.0f);
-
-
-            glm::vec3 cameraDir = glm::normalize(camera.target - camera.position);
-
-            glm::vec3 cameraX = glm::normalize(glm::cross(cameraDir, camera.up));
-            glm::vec3 cameraY = glm::normalize(glm::cross(cameraX, cameraDir));
-            glm::vec3 rayDirection = glm::normalize(
-                    cameraDir + cameraX * screenX + cameraY * screenY
-            );
-
-            Color pixelColor = castRay(camera.position, rayDirection);
-            /* Color pixelColor = castRay(glm::vec3(0,0,20), glm::normalize(glm::vec3(screenX, screenY, -1.0f))); */
-
-            point(glm::vec2(x, y), pixelColor);
+        if (description.hasCamera) {
+            camera = description.camera;
+        }
+        if (description.hasLight) {
+            light = description.light;
         }
+        if (!description.skybox.empty()) {
+            skybox.load(description.skybox);
+        }
+        skybox.setBilinear(options.skyBilinear);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    if (options.hasEye) {
+        camera.position = options.eye;
+    }
+    if (options.hasTarget) {
+        camera.target = options.target;
+    }
+
+    if (options.headless) {
+        return renderHeadless(options, pool);
     }
-}
 
-int main(int argc, char* argv[]) {
     // Initialize SDL
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
         SDL_Log("Unable to initialize SDL: %s", SDL_GetError());
@@ -448,7 +415,7 @@ int main(int argc, char* argv[]) {
     // Create a window
     SDL_Window *window = SDL_CreateWindow("Raytracer - FPS: 0",
                                           SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-                                          SCREEN_WIDTH, SCREEN_HEIGHT,
+                                          options.width, options.height,
                                           SDL_WINDOW_SHOWN);
 
     if (!window) {
@@ -467,76 +434,144 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    // Streaming texture the framebuffer is uploaded into once per frame
+    SDL_Texture* frameTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32,
+                                                  SDL_TEXTUREACCESS_STREAMING,
+                                                  options.width, options.height);
 
+    if (!frameTexture) {
+        SDL_Log("Unable to create frame texture: %s", SDL_GetError());
+        SDL_DestroyRenderer(renderer);
+        SDL_DestroyWindow(window);
+        SDL_Quit();
+        return 1;
+    }
+
+
+    FrameCache cache(options.width, options.height);
+    Framebuffer sample(options.width, options.height);
+    ReprojectionCache reprojection(options.width, options.height);
+    reprojection.refreshRatio = options.refreshPercent / 100.0f;
+    bool approximate = false;  // cached frame contains reprojected pixels
+    double lastReuse = 0.0;
     bool running = true;
+    bool useDrawPoints = false;
+    bool idle = false;
     SDL_Event event;
 
     int frameCount = 0;
     Uint32 startTime = SDL_GetTicks();
     Uint32 currentTime = startTime;
-
-    setUp();
+    const double ticksToMs = 1000.0 / static_cast<double>(SDL_GetPerformanceFrequency());
+    double renderMs = 0.0;
+    double presentMs = 0.0;
+    RenderStats secondStats;  // traced frames since the title was last updated
+    FILE* stats = openStats(options);
+    int frameNumber = 0;
 
 
     while (running) {
+        // Nothing left to trace: sleep until an event arrives instead of spinning on the same frame
+        if (idle && SDL_WaitEventTimeout(&event, 250)) {
+            handleEvent(event, running, useDrawPoints);
+        }
         while (SDL_PollEvent(&event)) {
-            if (event.type == SDL_QUIT) {
-                running = false;
-            }
-
-            if (event.type == SDL_KEYDOWN) {
-                switch(event.key.keysym.sym) {
-                    case SDLK_UP:
-                        print("up");
-                        camera.rotate(0.0f, 1.0f);
-                        break;
-                    case SDLK_DOWN:
-                        print("down");
-                        camera.rotate(0.0f, -1.0f);
-                        break;
-                    case SDLK_LEFT:
-                        print("left");
-                        camera.rotate(-1.0f, 0.0f);
-                        break;
-                    case SDLK_RIGHT:
-                        print("right");
-                        camera.rotate(1.0f, 0.0f);
-                        break;
-                    case SDLK_w:
-                        camera.move(1.0f);
-                        break;
-                    case SDLK_s:
-                        camera.move(-1.0f);
-                        break;
-
-
-                }
-            }
-
+            handleEvent(event, running, useDrawPoints);
+        }
 
+        // Only trace when camera, light, scene or settings changed since the cached frame,
+        // when its progressive passes have not reached full resolution yet, or when
+        // refine-while-idle still has samples to add to it. A change restarts at the coarsest pass.
+        ViewState state = ViewState::capture(camera, light, scene, raytracer.settings);
+        bool traced = false;
+        Uint64 renderStart = SDL_GetPerformanceCounter();
+        double reuse = -1.0;
+        if (options.reproject && cache.isDirty(state)) {
+            // Camera moves reuse what they can from the last frame, a still camera gets one exact frame
+            reprojection.render(raytracer, cache.framebuffer, camera, state, pool);
+            cache.store(state);
+            reuse = reprojection.reuseRatio();
+            approximate = reuse > 0.0;
+            traced = true;
+        } else if (options.reproject && approximate) {
+            reprojection.invalidate();
+            reprojection.render(raytracer, cache.framebuffer, camera, state, pool);
+            cache.store(state);
+            reuse = 0.0;
+            approximate = false;
+            traced = true;
+        } else if (cache.isDirty(state)) {
+            raytracer.renderPass(cache.framebuffer, camera, pool, options.previewStep, 0);
+            cache.store(state, options.previewStep);
+            traced = true;
+        } else if (cache.step() > 1) {
+            int step = cache.step() / 2;
+            raytracer.renderPass(cache.framebuffer, camera, pool, step, cache.step());
+            cache.store(state, step);
+            traced = true;
+        } else if (cache.sampleCount() < options.idleSamples) {
+            raytracer.render(sample, camera, pool, FrameCache::sampleOffset(cache.sampleCount()));
+            cache.accumulate(sample);
+            raytracer.resolve(cache.framebuffer, pool);
+            traced = true;
+        }
+        idle = !traced;
+        if (reuse >= 0.0) {
+            lastReuse = reuse;
         }
+        Uint64 presentStart = SDL_GetPerformanceCounter();
 
         // Clear the screen
         SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
         SDL_RenderClear(renderer);
 
-        render();
+        if (useDrawPoints) {
+            drawPoints(cache.framebuffer);
+        } else {
+            if (traced) {
+                cache.framebuffer.upload(frameTexture);
+            }
+            SDL_RenderCopy(renderer, frameTexture, nullptr, nullptr);
+        }
 
         // Present the renderer
         SDL_RenderPresent(renderer);
+        Uint64 frameEnd = SDL_GetPerformanceCounter();
+
+        if (traced) {
+            double frameRenderMs = static_cast<double>(presentStart - renderStart) * ticksToMs;
+            writeStats(stats, frameNumber++, frameRenderMs, reuse);
+            secondStats.merge(raytracer.getStats());
+            renderMs += frameRenderMs;
+            presentMs += static_cast<double>(frameEnd - presentStart) * ticksToMs;
+            frameCount++;
+        }
 
-        frameCount++;
-
-        // Calculate and display FPS
+        // Calculate and display FPS and the average render/present split
         if (SDL_GetTicks() - currentTime >= 1000) {
             currentTime = SDL_GetTicks();
-            std::string title = "Raytracer - FPS: " + std::to_string(frameCount);
+            char timing[160];
+            if (frameCount > 0) {
+                SDL_snprintf(timing, sizeof(timing), " - render: %.1f ms - present (%s): %.1f ms - bvh nodes/ray: %.1f - step: %d - samples: %d - reuse: %.0f%%",
+                             renderMs / frameCount, useDrawPoints ? "points" : "texture", presentMs / frameCount,
+                             secondStats.averageNodesVisited(), cache.step(), cache.sampleCount(), lastReuse * 100.0);
+            } else {
+                SDL_snprintf(timing, sizeof(timing), " - idle - samples: %d", cache.sampleCount());
+            }
+            secondStats.reset();
+            std::string title = "Raytracer - FPS: " + std::to_string(frameCount) + timing;
             SDL_SetWindowTitle(window, title.c_str());
             frameCount = 0;
+            renderMs = 0.0;
+            presentMs = 0.0;
         }
     }
 
     // Cleanup
+    if (stats && stats != stdout) {
+        std::fclose(stats);
+    }
+    SDL_DestroyTexture(frameTexture);
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
@@ -3,11 +3,26 @@
 #include "glm/glm.hpp"
 #include "material.h"
 #include "intersect.h"
+#include "aabb.h"
+
+// Tag set by each subclass so hot loops can dispatch without RTTI or virtual calls
+enum class PrimitiveType : unsigned char {
+    Cube,
+    Sphere,
+    Voxels
+};
+const int PRIMITIVE_TYPE_COUNT = 3;
 
 class Object {
 public:
-    Object(const Material& mat) : material(mat) {}
+    Object(const Material& mat, PrimitiveType type) : material(mat), type(type) {}
+    virtual ~Object() = default;
     virtual Intersect rayIntersect(const glm::vec3& rayOrigin, const glm::vec3& rayDirection) const = 0;
+    virtual AABB getBounds() const = 0;
+
+    // Any hit with BIAS <= t <= tMax. Only the distance is computed, written to tHit when given.
+    virtual bool occluded(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, float tMax, float* tHit = nullptr) const = 0;
 
     Material material;
+    PrimitiveType type;
 };
\ No newline at end of file
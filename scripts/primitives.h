@@ -0,0 +1,106 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+#include "aabb.h"
+#include "intersect.h"
+#include "object.h"
+#include "cube.h"
+#include "sphere.h"
+#include "voxelGrid.h"
+
+// Handle into PrimitiveStore: which typed array, and the slot in it
+struct PrimitiveRef {
+    PrimitiveType type;
+    uint32_t index;
+};
+
+// Scene primitives copied out of the Object* list into one contiguous array per
+// type, so hot loops switch on the tag and call the inline per-type test directly.
+class PrimitiveStore {
+public:
+    std::vector<Cube> cubes;
+    std::vector<Sphere> spheres;
+    std::vector<VoxelGrid> voxels;
+
+    void clear() {
+        cubes.clear();
+        spheres.clear();
+        voxels.clear();
+    }
+
+    // Copies every object into its typed array and returns a handle per object, in order
+    std::vector<PrimitiveRef> add(const std::vector<Object*>& objects) {
+        std::vector<PrimitiveRef> refs;
+        refs.reserve(objects.size());
+        for (const Object* object : objects) {
+            switch (object->type) {
+                case PrimitiveType::Cube:
+                    refs.push_back(PrimitiveRef{PrimitiveType::Cube, static_cast<uint32_t>(cubes.size())});
+                    cubes.push_back(*static_cast<const Cube*>(object));
+                    break;
+                case PrimitiveType::Sphere:
+                    refs.push_back(PrimitiveRef{PrimitiveType::Sphere, static_cast<uint32_t>(spheres.size())});
+                    spheres.push_back(*static_cast<const Sphere*>(object));
+                    break;
+                case PrimitiveType::Voxels:
+                    refs.push_back(PrimitiveRef{PrimitiveType::Voxels, static_cast<uint32_t>(voxels.size())});
+                    voxels.push_back(*static_cast<const VoxelGrid*>(object));
+                    break;
+            }
+        }
+        return refs;
+    }
+
+    size_t size() const {
+        return cubes.size() + spheres.size() + voxels.size();
+    }
+
+    const Object& get(PrimitiveRef ref) const {
+        switch (ref.type) {
+            case PrimitiveType::Cube:
+                return cubes[ref.index];
+            case PrimitiveType::Sphere:
+                return spheres[ref.index];
+            case PrimitiveType::Voxels:
+            default:
+                return voxels[ref.index];
+        }
+    }
+
+    AABB getBounds(PrimitiveRef ref) const {
+        switch (ref.type) {
+            case PrimitiveType::Cube:
+                return cubes[ref.index].Cube::getBounds();
+            case PrimitiveType::Sphere:
+                return spheres[ref.index].Sphere::getBounds();
+            case PrimitiveType::Voxels:
+            default:
+                return voxels[ref.index].VoxelGrid::getBounds();
+        }
+    }
+
+    bool occluded(PrimitiveRef ref, const glm::vec3& rayOrigin, const glm::vec3& rayDirection, float tMax, float* tHit = nullptr) const {
+        switch (ref.type) {
+            case PrimitiveType::Cube:
+                return cubes[ref.index].occludes(rayOrigin, rayDirection, tMax, tHit);
+            case PrimitiveType::Sphere:
+                return spheres[ref.index].occludes(rayOrigin, rayDirection, tMax, tHit);
+            case PrimitiveType::Voxels:
+            default:
+                return voxels[ref.index].occludes(rayOrigin, rayDirection, tMax, tHit);
+        }
+    }
+
+    Intersect rayIntersect(PrimitiveRef ref, const glm::vec3& rayOrigin, const glm::vec3& rayDirection) const {
+        switch (ref.type) {
+            case PrimitiveType::Cube:
+                return cubes[ref.index].intersect(rayOrigin, rayDirection);
+            case PrimitiveType::Sphere:
+                return spheres[ref.index].intersect(rayOrigin, rayDirection);
+            case PrimitiveType::Voxels:
+            default:
+                return voxels[ref.index].intersect(rayOrigin, rayDirection);
+        }
+    }
+};
@@ -0,0 +1,79 @@
+#pragma once
+#include <cfloat>
+#include "glm/glm.hpp"
+#include "aabb.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RAYPACKET_SSE 1
+#endif
+
+// Four coherent rays that share an origin, one direction per lane
+struct RayPacket {
+    static const int SIZE = 4;
+    static const int ALL_ACTIVE = (1 << SIZE) - 1;
+
+    glm::vec3 origin;
+    alignas(16) float dirX[SIZE];
+    alignas(16) float dirY[SIZE];
+    alignas(16) float dirZ[SIZE];
+    alignas(16) float invX[SIZE];
+    alignas(16) float invY[SIZE];
+    alignas(16) float invZ[SIZE];
+    int activeMask = 0;
+
+    void setRay(int lane, const glm::vec3& direction) {
+        dirX[lane] = direction.x;
+        dirY[lane] = direction.y;
+        dirZ[lane] = direction.z;
+        invX[lane] = 1.0f / direction.x;
+        invY[lane] = 1.0f / direction.y;
+        invZ[lane] = 1.0f / direction.z;
+        activeMask |= 1 << lane;
+    }
+
+    glm::vec3 direction(int lane) const {
+        return glm::vec3(dirX[lane], dirY[lane], dirZ[lane]);
+    }
+
+    glm::vec3 invDirection(int lane) const {
+        return glm::vec3(invX[lane], invY[lane], invZ[lane]);
+    }
+};
+
+// Slab test of every lane against one box. Writes the entry distance per lane and
+// returns the mask of lanes with lower < tNear < upper whose exit is not behind the origin.
+inline int packetSlab(const RayPacket& packet, const AABB& box,
+                      const float* lower, const float* upper, float* tNear) {
+#if defined(RAYPACKET_SSE)
+    // The origin is shared, so (bound - origin) is a scalar per axis
+    __m128 t0x = _mm_mul_ps(_mm_set1_ps(box.min.x - packet.origin.x), _mm_load_ps(packet.invX));
+    __m128 t1x = _mm_mul_ps(_mm_set1_ps(box.max.x - packet.origin.x), _mm_load_ps(packet.invX));
+    __m128 t0y = _mm_mul_ps(_mm_set1_ps(box.min.y - packet.origin.y), _mm_load_ps(packet.invY));
+    __m128 t1y = _mm_mul_ps(_mm_set1_ps(box.max.y - packet.origin.y), _mm_load_ps(packet.invY));
+    __m128 t0z = _mm_mul_ps(_mm_set1_ps(box.min.z - packet.origin.z), _mm_load_ps(packet.invZ));
+    __m128 t1z = _mm_mul_ps(_mm_set1_ps(box.max.z - packet.origin.z), _mm_load_ps(packet.invZ));
+
+    __m128 tEntry = _mm_max_ps(_mm_max_ps(_mm_min_ps(t0x, t1x), _mm_min_ps(t0y, t1y)), _mm_min_ps(t0z, t1z));
+    __m128 tExit = _mm_min_ps(_mm_min_ps(_mm_max_ps(t0x, t1x), _mm_max_ps(t0y, t1y)), _mm_max_ps(t0z, t1z));
+
+    __m128 hit = _mm_and_ps(_mm_cmple_ps(tEntry, tExit), _mm_cmpge_ps(tExit, _mm_setzero_ps()));
+    hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpgt_ps(tEntry, _mm_loadu_ps(lower)), _mm_cmplt_ps(tEntry, _mm_loadu_ps(upper))));
+    _mm_storeu_ps(tNear, tEntry);
+    return _mm_movemask_ps(hit) & packet.activeMask;
+#else
+    int mask = 0;
+    for (int lane = 0; lane < RayPacket::SIZE; lane++) {
+        glm::vec3 t0 = (box.min - packet.origin) * packet.invDirection(lane);
+        glm::vec3 t1 = (box.max - packet.origin) * packet.invDirection(lane);
+        glm::vec3 tSmall = glm::min(t0, t1);
+        glm::vec3 tBig = glm::max(t0, t1);
+        tNear[lane] = glm::max(glm::max(tSmall.x, tSmall.y), tSmall.z);
+        float tFar = glm::min(glm::min(tBig.x, tBig.y), tBig.z);
+        if (tNear[lane] <= tFar && tFar >= 0 && tNear[lane] > lower[lane] && tNear[lane] < upper[lane]) {
+            mask |= 1 << lane;
+        }
+    }
+    return mask & packet.activeMask;
+#endif
+}
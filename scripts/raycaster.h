@@ -6,11 +6,16 @@
 #include <SDL_render.h>
 #include <string>
 #include <vector>
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <limits>
 #include <SDL.h>
 #include <unordered_map>
 #include "color.h"
+#include "framebuffer.h"
 #include "imageLoader.h"
+#include "threadPool.h"
 
 using namespace std;
 
@@ -38,14 +43,15 @@ struct Player {
 
 struct Impact {
     float d;
-    string mapHit;
+    TextureHandle texture;  // -1 when the wall has no texture
     int ofx;
 };
 
 class Raycaster {
 public:
-    Raycaster(SDL_Renderer* renderer)
-            : renderer(renderer) {
+    // width x height is the size of the 3D view, one ray per column
+    Raycaster(SDL_Renderer* renderer, int width = SCREEN_WIDTH, int height = SCREEN_HEIGHT)
+            : framebuffer(width, height), renderer(renderer) {
         player.x = BLOCK + BLOCK / 2;
         player.y = BLOCK + BLOCK / 2;
         player.mapx = static_cast<int>(static_cast<int>(BLOCK/3) + static_cast<int>(BLOCK/3) / 2);
@@ -55,46 +61,104 @@ public:
         player.fov = M_PI /4.0f;
         scale = 40;
         textSize = 128;
+        std::fill(std::begin(textureIds), std::end(textureIds), -1);
+        fan.reserve(2 * MINIMAP_HEIGHT);
     }
 
+    ~Raycaster() {
+        if (screen) {
+            SDL_DestroyTexture(screen);
+        }
+        if (minimap) {
+            SDL_DestroyTexture(minimap);
+        }
+    }
+
+    Raycaster(const Raycaster&) = delete;
+    Raycaster& operator=(const Raycaster&) = delete;
+
     Player player;
+    Framebuffer framebuffer;  // 3D view, filled by render_view
+    bool useDDA = true;  // false walks every ray one unit at a time like before
+
+    // Cell values: the map character, EMPTY for ' ' and OUTSIDE for the border around the map
+    static const uint8_t EMPTY = 0;
+    static const uint8_t OUTSIDE = 1;
 
+    // Load the wall textures (ImageLoader keys are the map characters) before the map
     void load_map(const string& filename) {
         ifstream file(filename);
         string line;
+        vector<string> rows;
         while (getline(file, line)) {
-            map.push_back(line);
+            rows.push_back(line);
         }
         file.close();
+        set_map(rows);
+    }
+
+    // Copies the rows into the grid, short rows are padded with empty cells
+    void set_map(const vector<string>& rows) {
+        mapHeight = static_cast<int>(rows.size());
+        mapWidth = 0;
+        for (const string& row : rows) {
+            mapWidth = std::max(mapWidth, static_cast<int>(row.size()));
+        }
+        cells.assign(static_cast<size_t>(mapWidth + 2) * (mapHeight + 2), OUTSIDE);
+        for (int j = 0; j < mapHeight; j++) {
+            for (int i = 0; i < mapWidth; i++) {
+                char c = i < static_cast<int>(rows[j].size()) ? rows[j][i] : ' ';
+                cells[index(i, j)] = c == ' ' ? EMPTY : static_cast<uint8_t>(c);
+            }
+        }
+        resolve_textures();
+    }
+
+    // Looks up the texture of every cell value again, after images were (re)loaded
+    void resolve_textures() {
+        minimapDirty = true;
+        for (int c = 0; c < 256; c++) {
+            textureIds[c] = c == EMPTY || c == OUTSIDE ? -1 : ImageLoader::findHandle(string(1, static_cast<char>(c)));
+        }
     }
 
     void print_map() {
-        for (const string& line : map) {
+        for (int j = 0; j < mapHeight; j++) {
+            string line;
+            for (int i = 0; i < mapWidth; i++) {
+                line += cell(i, j) == EMPTY ? ' ' : static_cast<char>(cell(i, j));
+            }
             cout << line << endl;
         }
     }
 
+    // Cell (i, j), i in [-1, mapWidth] and j in [-1, mapHeight] so the border can be read too
+    uint8_t cell(int i, int j) const {
+        return cells[index(i, j)];
+    }
+
     void point(int x, int y, Color c) {
         SDL_SetRenderDrawColor(renderer, c.r, c.g, c.b, c.a);
         SDL_RenderDrawPoint(renderer, x, y);
     }
 
-    void rect(int x, int y, const string& mapHit) {
+    // Paints one minimap tile into layer
+    void rect(Framebuffer& layer, int x, int y, TextureHandle texture) {
         for(int cx = x; cx < x + static_cast<int>(BLOCK/3); cx++){
             for(int cy = y; cy < y + static_cast<int>(BLOCK/3); cy++){
                 int tx = ((cx - x) * textSize) / static_cast<int>(BLOCK /3) ;
                 int ty = ((cy - y) * textSize) / static_cast<int>(BLOCK /3);
-                Color c = ImageLoader::getPixelColor(mapHit, tx, ty);
-                SDL_SetRenderDrawColor(renderer, c.r, c.g, c.b, 255);
-                //SDL_Rect rect = { x, y, BLOCK, BLOCK };
-                SDL_RenderDrawPoint(renderer, cx, cy);
+                Color c = ImageLoader::sample(texture, tx, ty);
+                c.a = 255;
+                layer.setPixel(cx, cy, c);
             }
         }
     }
 
-    Impact cast_ray(float a) {
+    // Old traversal, one unit along the ray per step. Kept to compare against the DDA (useDDA = false).
+    Impact cast_ray_marching(float a) {
         float d = 0;
-        string mapHit;
+        TextureHandle texture;
         int tx;
         int x = static_cast<int>(player.x + d * cos(a));
         int y = static_cast<int>(player.y + d * sin(a));
@@ -103,8 +167,8 @@ public:
             int i = static_cast<int>(x / BLOCK);
             int j = static_cast<int>(y / BLOCK);
 
-            if (map[j][i] != ' ') {
-                mapHit = map[j][i];
+            if (cell(i, j) != EMPTY) {
+                texture = textureIds[cell(i, j)];
                 int hitx = x - i * BLOCK;
                 int hity = y - j * BLOCK;
                 int maxHit;
@@ -123,12 +187,12 @@ public:
             x = static_cast<int>(player.x + d * cos(a));
             y = static_cast<int>(player.y + d * sin(a));
         }
-        return Impact{d, mapHit, tx};
+        return Impact{d, texture, tx};
     }
 
-    Impact cast_ray_map(float a) {
+    Impact cast_ray_map_marching(float a) {
         float d = 0;
-        string mapHit;
+        TextureHandle texture;
         int tx;
         int x = static_cast<int>(player.mapx + d * cos(a));
         int y = static_cast<int>(player.mapy + d * sin(a));
@@ -137,8 +201,8 @@ public:
             int i = static_cast<int>(x / (BLOCK/3));
             int j = static_cast<int>(y / (BLOCK/3));
 
-            if (map[j][i] != ' ') {
-                mapHit = map[j][i];
+            if (cell(i, j) != EMPTY) {
+                texture = textureIds[cell(i, j)];
                 int hitx = x - i * static_cast<int>(BLOCK/3);
                 int hity = y - j * static_cast<int>(BLOCK/3);
                 int maxHit;
@@ -157,75 +221,260 @@ public:
             x = static_cast<int>(player.mapx + d * cos(a));
             y = static_cast<int>(player.mapy + d * sin(a));
         }
-        return Impact{d, mapHit, tx};
+        return Impact{d, texture, tx};
     }
 
-    void draw_stake(int x, float h, Impact i) {
-        float start = SCREEN_HEIGHT / 2.0f - h / 2.0f;
-        float end = start + h;
-        for (int y = start; y < end; y++) {
-            int ty = ((y - start) * textSize) / h;
-            Color c = ImageLoader::getPixelColor(i.mapHit, i.ofx,ty);
-            SDL_SetRenderDrawColor(renderer, c.r, c.g, c.b, c.a);
-            SDL_Rect rect = { x, static_cast<int>(start), 1, static_cast<int>(h) };
-            SDL_RenderDrawPoint(renderer, x,y);
+    Impact cast_ray(float a) {
+        if (!useDDA) {
+            return cast_ray_marching(a);
         }
+        return cast_grid(static_cast<float>(player.x), static_cast<float>(player.y), a, BLOCK);
+    }
+
+    Impact cast_ray_map(float a) {
+        if (!useDDA) {
+            return cast_ray_map_marching(a);
+        }
+        return cast_grid(static_cast<float>(player.mapx), static_cast<float>(player.mapy), a,
+                         static_cast<int>(BLOCK/3));
+    }
+
+    // Walks the map cell by cell (Amanatides-Woo DDA) from (x, y) in pixels, visiting only the
+    // grid lines the ray crosses. d is the exact distance to the wall and ofx the texture
+    // column at the hit point. The border around the map stops every ray, without a texture.
+    Impact cast_grid(float x, float y, float a, int cellSize) const {
+        const float dirX = cos(a);
+        const float dirY = sin(a);
+        int i = static_cast<int>(std::floor(x / cellSize));
+        int j = static_cast<int>(std::floor(y / cellSize));
+        const bool inside = i >= 0 && j >= 0 && i < mapWidth && j < mapHeight;
+        if (!inside || cell(i, j) != EMPTY) {
+            return Impact{0, inside ? textureIds[cell(i, j)] : -1, 0};
+        }
+
+        const float inf = std::numeric_limits<float>::infinity();
+        const int stepX = dirX < 0 ? -1 : 1;
+        const int stepY = dirY < 0 ? -1 : 1;
+        const float deltaX = dirX != 0 ? std::abs(cellSize / dirX) : inf;
+        const float deltaY = dirY != 0 ? std::abs(cellSize / dirY) : inf;
+        float sideX = dirX != 0 ? (dirX < 0 ? x - i * cellSize : (i + 1) * cellSize - x) / std::abs(dirX) : inf;
+        float sideY = dirY != 0 ? (dirY < 0 ? y - j * cellSize : (j + 1) * cellSize - y) / std::abs(dirY) : inf;
+
+        float d = 0;
+        bool vertical = false;  // the last line crossed was x = const
+        while (true) {
+            if (sideX < sideY) {
+                d = sideX;
+                sideX += deltaX;
+                i += stepX;
+                vertical = true;
+            } else {
+                d = sideY;
+                sideY += deltaY;
+                j += stepY;
+                vertical = false;
+            }
+            if (cell(i, j) != EMPTY) {
+                break;
+            }
+        }
+
+        // Offset of the hit along the wall face, in [0, cellSize)
+        float offset = vertical ? y + d * dirY - j * cellSize : x + d * dirX - i * cellSize;
+        int tx = static_cast<int>(offset * textSize / cellSize);
+        tx = std::clamp(tx, 0, textSize - 1);
+        return Impact{d, textureIds[cell(i, j)], tx};
     }
 
-    void draw_stake_minimap(int x, float h, Impact i) {
+    // Writes one full column of framebuffer: ceiling, wall and floor. Only the rows on screen
+    // are visited, a wall right in front of the player can be thousands of pixels tall.
+    void draw_stake(int x, float h, const Impact& i) {
+        const int height = framebuffer.height;
+        const size_t stride = framebuffer.width;
+        Color* pixel = &framebuffer.pixels[x];
+        h = std::min(h, height * 1024.0f);  // a player standing on a grid line can see a wall at distance 0
+        float start = height / 2.0f - h / 2.0f;
+        int y0 = std::clamp(static_cast<int>(std::ceil(start)), 0, height);
+        int y1 = std::clamp(static_cast<int>(std::ceil(start + h)), y0, height);
+        if (i.texture < 0) {
+            y1 = y0;
+        }
+
+        int y = 0;
+        for (; y < y0; y++, pixel += stride) {
+            *pixel = B;
+        }
+        if (y0 < y1) {
+            const Color* texels = ImageLoader::column(i.texture, i.ofx);
+            // Texture row in 16.16 fixed point, textSize / h texels per screen row
+            const uint32_t step = static_cast<uint32_t>(textSize * 65536.0f / h);
+            uint32_t ty = static_cast<uint32_t>((y0 - start) * textSize * 65536.0f / h);
+            const uint32_t last = textSize - 1;
+            for (; y < y1; y++, pixel += stride) {
+                *pixel = texels[std::min(ty >> 16, last)];
+                ty += step;
+            }
+        }
+        for (; y < height; y++, pixel += stride) {
+            *pixel = B;
+        }
+    }
+
+    void draw_stake_minimap(int x, float h, const Impact& i) {
         float start = MAPHEIGHT / 2.0f - h / 2.0f;
         float end = start + h;
+        if (i.texture < 0) {
+            return;
+        }
         for (int y = start; y < end; y++) {
             int ty = ((y - start) * textSize) / h;
-            Color c = ImageLoader::getPixelColor(i.mapHit, i.ofx,ty);
+            Color c = ImageLoader::sample(i.texture, i.ofx, ty);
             SDL_SetRenderDrawColor(renderer, c.r, c.g, c.b, c.a);
             SDL_Rect rect = { x, static_cast<int>(start), 1, static_cast<int>(h) };
             SDL_RenderDrawPoint(renderer, x,y);
         }
     }
 
-    void render() {
-        const int numRays = SCREEN_WIDTH; // Número de rayos
+    // Casts every column into framebuffer, no SDL calls
+    void render_view() {
+        check_player();
+        cast_columns(0, framebuffer.width);
+    }
+
+    // Same frame with COLUMN_RANGE wide column ranges cast in parallel. Each column is
+    // independent and only writes its own framebuffer column.
+    void render_view(ThreadPool& pool) {
+        check_player();
+        const int ranges = (framebuffer.width + COLUMN_RANGE - 1) / COLUMN_RANGE;
+        pool.parallelFor(ranges, [&](int range) {
+            int first = range * COLUMN_RANGE;
+            cast_columns(first, std::min(first + COLUMN_RANGE, framebuffer.width));
+        });
+    }
+
+    // Columns [first, last) of the view, one ray each
+    void cast_columns(int first, int last) {
+        const int numRays = framebuffer.width; // Número de rayos
         const double deltaAngle = player.fov / numRays;
-        // draw right side of the screen
-        for (int i = 0; i < numRays; i++) {
+        for (int i = first; i < last; i++) {
             double a = player.a + player.fov / 2 - deltaAngle * i;
             Impact impact = cast_ray(a);
             float d = impact.d;
-            Color c = Color(255,0,0);
-            if (d == 0) {
-                print("you lose");
-                exit(1);
-            }
             int x = i;
-            float h = static_cast<float>(SCREEN_HEIGHT)/static_cast<float>(d * cos(a - player.a)) * static_cast<float>(scale);
+            float h = static_cast<float>(framebuffer.height)/static_cast<float>(d * cos(a - player.a)) * static_cast<float>(scale);
             draw_stake(x, h, impact);
         }
+    }
+
+    // Uploads framebuffer into one streaming texture and copies it to the screen
+    void present() {
+        if (!screen) {
+            screen = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING,
+                                       framebuffer.width, framebuffer.height);
+        }
+        if (screen && framebuffer.upload(screen)) {
+            SDL_Rect destRect = { 0, 0, framebuffer.width, framebuffer.height };
+            SDL_RenderCopy(renderer, screen, nullptr, &destRect);
+        }
+    }
+
+    // pool casts the 3D view in parallel when given
+    void render(ThreadPool* pool = nullptr) {
+        // draw right side of the screen
+        if (pool) {
+            render_view(*pool);
+        } else {
+            render_view();
+        }
+        present();
 
         // draw left side of the screen
-        for (int x = 0; x < static_cast<int>(SCREEN_WIDTH /3); x += static_cast<int>(BLOCK /3)) {
-            for (int y = 0; y < static_cast<int>(SCREEN_HEIGHT /3); y += static_cast<int>(BLOCK /3)) {
+        if (minimapDirty) {
+            bake_minimap();
+        }
+        if (minimap) {
+            SDL_Rect destRect = { 0, 0, MINIMAP_WIDTH, MINIMAP_HEIGHT };
+            SDL_RenderCopy(renderer, minimap, nullptr, &destRect);
+        }
+
+        if (!useDDA) {
+            for (int i = 1; i < MINIMAP_HEIGHT; i += 1) {
+                float a = player.mapA + player.fov / 2 - player.fov * i / MINIMAP_HEIGHT;
+                cast_ray_map(a);
+            }
+            return;
+        }
+
+        // The fan as one polyline player, hit, player, hit... from the DDA hit points
+        fan.clear();
+        for (int i = 1; i < MINIMAP_HEIGHT; i += 1) {
+            float a = player.mapA + player.fov / 2 - player.fov * i / MINIMAP_HEIGHT;
+            Impact impact = cast_ray_map(a);
+            fan.push_back(SDL_Point{player.mapx, player.mapy});
+            fan.push_back(SDL_Point{static_cast<int>(player.mapx + impact.d * cos(a)),
+                                    static_cast<int>(player.mapy + impact.d * sin(a))});
+        }
+        SDL_SetRenderDrawColor(renderer, W.r, W.g, W.b, W.a);
+        SDL_RenderDrawLines(renderer, fan.data(), static_cast<int>(fan.size()));
+    }
+
+
+private:
+    static const int COLUMN_RANGE = 64;
+    static const int MINIMAP_WIDTH = SCREEN_WIDTH / 3;
+    static const int MINIMAP_HEIGHT = SCREEN_HEIGHT / 3;
+
+    // The map tiles never change, so they are painted once into a static texture that every
+    // frame copies. Cells without a wall stay transparent over the 3D view.
+    void bake_minimap() {
+        minimapDirty = false;
+        if (!minimap) {
+            minimap = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC,
+                                        MINIMAP_WIDTH, MINIMAP_HEIGHT);
+            if (!minimap) {
+                return;
+            }
+            SDL_SetTextureBlendMode(minimap, SDL_BLENDMODE_BLEND);
+        }
+
+        Framebuffer layer(MINIMAP_WIDTH, MINIMAP_HEIGHT);
+        layer.clear(Color(0, 0, 0, 0));
+        for (int x = 0; x < MINIMAP_WIDTH; x += static_cast<int>(BLOCK /3)) {
+            for (int y = 0; y < MINIMAP_HEIGHT; y += static_cast<int>(BLOCK /3)) {
                 int i = static_cast<int>(x / static_cast<int>(BLOCK /3));
                 int j = static_cast<int>(y / static_cast<int>(BLOCK /3));
-                if (map[j][i] != ' ') {
-                    string mapHit;
-                    mapHit = map[j][i];
-                    rect(x, y, mapHit);
+                if (i < mapWidth && j < mapHeight && textureIds[cell(i, j)] >= 0) {
+                    rect(layer, x, y, textureIds[cell(i, j)]);
                 }
             }
-            // Avanzar a la siguiente columna del mapa
         }
+        SDL_UpdateTexture(minimap, nullptr, layer.pixels.data(), MINIMAP_WIDTH * sizeof(Color));
+    }
 
-        for (int i = 1; i < static_cast<int>(SCREEN_HEIGHT/3) ; i+=1) {
-            float a = player.mapA + player.fov / 2 - player.fov * i / static_cast<int>(SCREEN_HEIGHT/3);
-            cast_ray_map(a);
+    // A ray starting inside a wall has distance 0. Checked once per frame on the calling
+    // thread, the workers casting columns cannot end the program.
+    void check_player() {
+        int i = static_cast<int>(std::floor(static_cast<float>(player.x) / BLOCK));
+        int j = static_cast<int>(std::floor(static_cast<float>(player.y) / BLOCK));
+        if (i < 0 || j < 0 || i >= mapWidth || j >= mapHeight || cell(i, j) != EMPTY) {
+            print("you lose");
+            exit(1);
         }
     }
 
+    size_t index(int i, int j) const {
+        return static_cast<size_t>(j + 1) * (mapWidth + 2) + (i + 1);
+    }
 
-private:
     int scale;
     SDL_Renderer* renderer;
-    vector<string> map;
+    SDL_Texture* screen = nullptr;
+    SDL_Texture* minimap = nullptr;  // baked map tiles, rebuilt after set_map/resolve_textures
+    bool minimapDirty = true;
+    vector<SDL_Point> fan;  // ray fan polyline, reused every frame
+    int mapWidth = 0;
+    int mapHeight = 0;
+    vector<uint8_t> cells;  // (mapWidth + 2) x (mapHeight + 2), row by row, including the border
+    TextureHandle textureIds[256];  // texture of each cell value, -1 for none
     int textSize;
 };
\ No newline at end of file
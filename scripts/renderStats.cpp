@@ -0,0 +1,39 @@
+#include "renderStats.h"
+
+void RenderStats::merge(const RenderStats& other) {
+    primaryRays += other.primaryRays;
+    shadowRays += other.shadowRays;
+    reflectionRays += other.reflectionRays;
+    refractionRays += other.refractionRays;
+    skyboxLookups += other.skyboxLookups;
+    bvhRays += other.bvhRays;
+    nodesVisited += other.nodesVisited;
+    for (int i = 0; i < PRIMITIVE_TYPE_COUNT; i++) {
+        primitiveTests[i] += other.primitiveTests[i];
+    }
+    for (int i = 0; i < MAX_DEPTH; i++) {
+        depthHistogram[i] += other.depthHistogram[i];
+    }
+}
+
+std::string RenderStats::toJson() const {
+    static const char* const typeNames[PRIMITIVE_TYPE_COUNT] = {"cube", "sphere", "voxels"};
+
+    std::string json = "{\"primary\": " + std::to_string(primaryRays) +
+                       ", \"shadow\": " + std::to_string(shadowRays) +
+                       ", \"reflection\": " + std::to_string(reflectionRays) +
+                       ", \"refraction\": " + std::to_string(refractionRays) +
+                       ", \"skybox\": " + std::to_string(skyboxLookups) +
+                       ", \"bvh_rays\": " + std::to_string(bvhRays) +
+                       ", \"bvh_nodes\": " + std::to_string(nodesVisited) +
+                       ", \"tests\": {";
+    for (int i = 0; i < PRIMITIVE_TYPE_COUNT; i++) {
+        json += (i ? ", \"" : "\"") + std::string(typeNames[i]) + "\": " + std::to_string(primitiveTests[i]);
+    }
+    json += "}, \"depth\": [";
+    for (int i = 0; i < MAX_DEPTH; i++) {
+        json += (i ? ", " : "") + std::to_string(depthHistogram[i]);
+    }
+    json += "]}";
+    return json;
+}
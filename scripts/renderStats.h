@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "object.h"
+
+// Ray and intersection counters. Every thread counts into its own local() copy, the
+// renderer folds those into one total per frame, so counting never touches shared memory.
+struct RenderStats {
+    static const int MAX_DEPTH = 8;  // deeper rays land in the last histogram bucket
+
+    uint64_t primaryRays = 0;
+    uint64_t shadowRays = 0;
+    uint64_t reflectionRays = 0;
+    uint64_t refractionRays = 0;
+    uint64_t skyboxLookups = 0;
+    uint64_t bvhRays = 0;  // BVH queries, a packet counts one per active lane
+    uint64_t nodesVisited = 0;  // BVH nodes those queries visited
+    uint64_t primitiveTests[PRIMITIVE_TYPE_COUNT] = {};  // indexed by PrimitiveType
+    uint64_t depthHistogram[MAX_DEPTH] = {};  // castRay calls per recursion depth
+
+    void countTest(PrimitiveType type, uint64_t count = 1) {
+        primitiveTests[static_cast<int>(type)] += count;
+    }
+
+    void countDepth(int depth, uint64_t count = 1) {
+        depthHistogram[depth < MAX_DEPTH ? depth : MAX_DEPTH - 1] += count;
+    }
+
+    double averageNodesVisited() const {
+        return bvhRays == 0 ? 0.0 : static_cast<double>(nodesVisited) / bvhRays;
+    }
+
+    void reset() { *this = RenderStats(); }
+    void merge(const RenderStats& other);
+
+    // Single line JSON object with every counter
+    std::string toJson() const;
+
+    // Counters of the calling thread
+    static RenderStats& local() {
+        thread_local RenderStats stats;
+        return stats;
+    }
+};
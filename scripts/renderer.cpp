@@ -0,0 +1,362 @@
+#include "renderer.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <random>
+
+Renderer::Renderer(const Scene& scene, const Light& light, const Skybox& skybox)
+        : scene(scene), light(light), skybox(skybox) {}
+
+// Voxel grids can shadow themselves, so only their own voxel is skipped (through BIAS), not the whole grid
+static const Object* shadowIgnore(const Object* hitObject) {
+    return hitObject && hitObject->type == PrimitiveType::Voxels ? nullptr : hitObject;
+}
+
+// Occluders close to the surface darken it more than ones close to the light
+static float shadowFalloff(float occluderDist, float lightDistance) {
+    float shadowRatio = occluderDist / lightDistance;
+    shadowRatio = glm::min(1.0f, shadowRatio);
+    return 1.0f - shadowRatio;
+}
+
+float Renderer::castShadow(const glm::vec3& shadowOrigin, const glm::vec3& lightDir, const Object* hitObject) const {
+    RenderStats::local().shadowRays++;
+    float lightDistance = glm::length(light.position - shadowOrigin);
+    float occluderDist;
+    // The falloff depends on where the occluder is, so this needs the nearest one, not any
+    if (scene.nearestOccluder(shadowOrigin, lightDir, lightDistance, shadowIgnore(hitObject), occluderDist)) {
+        return shadowFalloff(occluderDist, lightDistance);
+    }
+    return 1.0f;
+}
+
+// Lighting for a ray that already found its hit and shadow term
+HDRColor Renderer::shade(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, const Intersect& intersect,
+                         const Object* hitObject, float shadowIntensity, const short recursion) const {
+    glm::vec3 lightDir = glm::normalize(light.position - intersect.point);
+    glm::vec3 viewDir = glm::normalize(rayOrigin - intersect.point);
+    glm::vec3 reflectDir = glm::reflect(-lightDir, intersect.normal);
+
+    float diffuseLightIntensity = std::max(0.0f, glm::dot(intersect.normal, lightDir));
+    float specReflection = glm::dot(viewDir, reflectDir);
+
+    Material mat = intersect.material ? *intersect.material : hitObject->material;
+
+    float specLightIntensity = std::pow(std::max(0.0f, glm::dot(viewDir, reflectDir)), mat.specularCoefficient);
+
+    HDRColor reflectedColor;
+    if (mat.reflectivity > 0) {
+        glm::vec3 origin = intersect.point + intersect.normal * BIAS;
+        RenderStats::local().reflectionRays++;
+        reflectedColor = castRay(origin, reflectDir, recursion + 1);
+    }
+
+    HDRColor refractedColor;
+    if (mat.transparency > 0) {
+        glm::vec3 origin = intersect.point - intersect.normal * BIAS;
+        glm::vec3 refractDir = glm::refract(rayDirection, intersect.normal, mat.refractionIndex);
+        RenderStats::local().refractionRays++;
+        refractedColor = castRay(origin, refractDir, recursion + 1);
+    }
+
+    HDRColor diffuseLight = HDRColor(mat.diffuse) * (light.intensity * diffuseLightIntensity * mat.albedo * shadowIntensity);
+    HDRColor specularLight = HDRColor(light.color) * (light.intensity * specLightIntensity * mat.specularAlbedo * shadowIntensity);
+    // Glass is reflective and fully transparent, so the direct share would go negative
+    float surface = std::max(0.0f, 1.0f - mat.reflectivity - mat.transparency);
+    HDRColor color = (diffuseLight + specularLight) * surface + reflectedColor * mat.reflectivity + refractedColor * mat.transparency;
+    return color;
+}
+
+HDRColor Renderer::castRay(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, const short recursion,
+                           float* hitDistance) const {
+    RenderStats& stats = RenderStats::local();
+    stats.countDepth(recursion);
+    if (recursion == 0) {
+        stats.primaryRays++;
+    }
+
+    const Object* hitObject = nullptr;
+    Intersect intersect;
+    scene.bvh.closestHit(rayOrigin, rayDirection, intersect, hitObject);
+
+    if (!intersect.isIntersecting || recursion >= settings.maxRecursion) {
+        stats.skyboxLookups++;
+        if (hitDistance) {
+            *hitDistance = std::numeric_limits<float>::infinity();
+        }
+        return HDRColor(skybox.getColor(rayDirection));  // Sky color
+    }
+    if (hitDistance) {
+        *hitDistance = intersect.dist;
+    }
+
+    glm::vec3 lightDir = glm::normalize(light.position - intersect.point);
+    float shadowIntensity = castShadow(intersect.point, lightDir, hitObject);
+
+    return shade(rayOrigin, rayDirection, intersect, hitObject, shadowIntensity, recursion);
+}
+
+// Traces up to four primary rays from the camera as one packet, then the shadow rays of the
+// lanes that hit something as a second one. Those start at the surfaces and need the nearest
+// occluder for the falloff, so they go through nearestOccluderPacket with the same inputs castShadow uses.
+void Renderer::castPacket(const RayPacket& primary, HDRColor colors[RayPacket::SIZE], float distances[RayPacket::SIZE]) const {
+    Intersect intersects[RayPacket::SIZE];
+    const Object* hitObjects[RayPacket::SIZE];
+    scene.bvh.closestHitPacket(primary, intersects, hitObjects);
+
+    glm::vec3 shadowOrigins[RayPacket::SIZE];
+    glm::vec3 lightDirs[RayPacket::SIZE];
+    float lightDistance[RayPacket::SIZE] = {};
+    float occluderDist[RayPacket::SIZE] = {};
+    const Object* ignore[RayPacket::SIZE] = {};
+    int shadowMask = 0;
+    for (int lane = 0; lane < RayPacket::SIZE; lane++) {
+        if ((primary.activeMask & (1 << lane)) && hitObjects[lane]) {
+            ignore[lane] = shadowIgnore(hitObjects[lane]);
+            shadowOrigins[lane] = intersects[lane].point;
+            lightDirs[lane] = glm::normalize(light.position - shadowOrigins[lane]);
+            lightDistance[lane] = glm::length(light.position - shadowOrigins[lane]);
+            shadowMask |= 1 << lane;
+        }
+    }
+    int occluded = scene.bvh.nearestOccluderPacket(shadowOrigins, lightDirs, lightDistance, ignore, shadowMask, occluderDist);
+
+    RenderStats& stats = RenderStats::local();
+    const int lanes = std::popcount(static_cast<unsigned>(primary.activeMask));
+    stats.primaryRays += lanes;
+    stats.countDepth(0, lanes);
+    stats.shadowRays += std::popcount(static_cast<unsigned>(shadowMask));
+
+    // Lanes that missed everything look up the sky together
+    glm::vec3 skyDirections[RayPacket::SIZE];
+    Color skyColors[RayPacket::SIZE];
+    int skyLanes[RayPacket::SIZE];
+    int skyCount = 0;
+    for (int lane = 0; lane < RayPacket::SIZE; lane++) {
+        if ((primary.activeMask & (1 << lane)) && !hitObjects[lane]) {
+            skyDirections[skyCount] = primary.direction(lane);
+            skyLanes[skyCount++] = lane;
+        }
+    }
+    skybox.getColors(std::span<const glm::vec3>(skyDirections, skyCount), std::span<Color>(skyColors, skyCount));
+    stats.skyboxLookups += skyCount;
+    for (int i = 0; i < skyCount; i++) {
+        distances[skyLanes[i]] = std::numeric_limits<float>::infinity();
+        colors[skyLanes[i]] = HDRColor(skyColors[i]);
+    }
+
+    for (int lane = 0; lane < RayPacket::SIZE; lane++) {
+        if (!(primary.activeMask & (1 << lane)) || !hitObjects[lane]) {
+            continue;
+        }
+
+        float shadowIntensity = 1.0f;
+        if (occluded & (1 << lane)) {
+            shadowIntensity = shadowFalloff(occluderDist[lane], lightDistance[lane]);
+        }
+        distances[lane] = intersects[lane].dist;
+        colors[lane] = shade(primary.origin, primary.direction(lane), intersects[lane], hitObjects[lane], shadowIntensity, 0);
+    }
+}
+
+glm::vec3 Renderer::View::primaryRay(int x, int y) const {
+    float screenX = (2.0f * (x + subpixel.x)) / width - 1.0f;
+    float screenY = -(2.0f * (y + subpixel.y)) / height + 1.0f;
+    screenX *= aspectRatio;
+    screenX *= tanHalfFov;
+    screenY *= tanHalfFov;
+    return glm::normalize(cameraDir + cameraX * screenX + cameraY * screenY);
+}
+
+bool Renderer::View::project(const glm::vec3& point, float& x, float& y) const {
+    glm::vec3 toPoint = point - position;
+    float forward = glm::dot(toPoint, cameraDir);
+    if (forward <= 0.0f) {
+        return false;
+    }
+    float screenX = glm::dot(toPoint, cameraX) / forward / (tanHalfFov * aspectRatio);
+    float screenY = glm::dot(toPoint, cameraY) / forward / tanHalfFov;
+    x = (screenX + 1.0f) * 0.5f * width - subpixel.x;
+    y = (1.0f - screenY) * 0.5f * height - subpixel.y;
+    return true;
+}
+
+// Everything castRay reads (scene, light, skybox) is only modified between
+// frames on the main thread, so tiles can trace it concurrently.
+void Renderer::renderTile(int tile, const View& view, Framebuffer& framebuffer) const {
+    // std::rand() shares hidden state between threads, each worker gets its own engine
+    thread_local std::minstd_rand rng(std::random_device{}());
+    std::uniform_real_distribution<float> random(0.0f, 1.0f);
+
+    const int tilesX = (view.width + TILE_SIZE - 1) / TILE_SIZE;
+    const int x0 = (tile % tilesX) * TILE_SIZE;
+    const int y0 = (tile / tilesX) * TILE_SIZE;
+    const int x1 = std::min(x0 + TILE_SIZE, view.width);
+    const int y1 = std::min(y0 + TILE_SIZE, view.height);
+    const int step = view.step;
+
+    // Pixels on the skipStep grid were traced by an earlier, coarser pass
+    auto needsTrace = [&](int x, int y) {
+        if (view.mask && !view.mask[static_cast<size_t>(y) * view.width + x]) {
+            return false;
+        }
+        return view.skipStep == 0 || (x % view.skipStep) != 0 || (y % view.skipStep) != 0;
+    };
+
+    if (settings.usePackets && settings.maxRecursion > 0) {
+        // 2x2 quads of grid points, lanes outside the screen or already traced stay inactive
+        for (int y = y0; y < y1; y += 2 * step) {
+            for (int x = x0; x < x1; x += 2 * step) {
+                RayPacket packet;
+                packet.origin = view.position;
+                for (int lane = 0; lane < RayPacket::SIZE; lane++) {
+                    int px = x + (lane & 1) * step;
+                    int py = y + (lane >> 1) * step;
+                    if (px < x1 && py < y1 && needsTrace(px, py)) {
+                        packet.setRay(lane, view.primaryRay(px, py));
+                    }
+                }
+                if (packet.activeMask == 0) {
+                    continue;
+                }
+
+                HDRColor colors[RayPacket::SIZE];
+                float distances[RayPacket::SIZE];
+                castPacket(packet, colors, distances);
+                for (int lane = 0; lane < RayPacket::SIZE; lane++) {
+                    if (packet.activeMask & (1 << lane)) {
+                        int px = x + (lane & 1) * step;
+                        int py = y + (lane >> 1) * step;
+                        framebuffer.setRadiance(px, py, colors[lane]);
+                        if (view.depth) {
+                            view.depth[static_cast<size_t>(py) * view.width + px] = distances[lane];
+                        }
+                    }
+                }
+            }
+        }
+    } else {
+        for (int y = y0; y < y1; y += step) {
+            for (int x = x0; x < x1; x += step) {
+                if (!needsTrace(x, y)) {
+                    continue;
+                }
+
+                float random_value = random(rng);
+                if (random_value < 0.0 ) {
+                    continue;
+                }
+
+                glm::vec3 rayDirection = view.primaryRay(x, y);
+
+                float distance;
+                HDRColor pixelColor = castRay(view.position, rayDirection, 0, &distance);
+                /* Color pixelColor = castRay(glm::vec3(0,0,20), glm::normalize(glm::vec3(screenX, screenY, -1.0f))); */
+
+                framebuffer.setRadiance(x, y, pixelColor);
+                if (view.depth) {
+                    view.depth[static_cast<size_t>(y) * view.width + x] = distance;
+                }
+            }
+        }
+    }
+
+    // Nearest-sample upsampling: each step x step block takes the color of its top-left sample.
+    // TILE_SIZE is a multiple of step, so blocks never cross into another tile.
+    if (step > 1) {
+        for (int y = y0; y < y1; y++) {
+            for (int x = x0; x < x1; x++) {
+                if (x % step != 0 || y % step != 0) {
+                    framebuffer.setRadiance(x, y, framebuffer.getRadiance(x - x % step, y - y % step));
+                }
+            }
+        }
+    }
+
+    // The tile is still in cache, so this is the frame's only pass from radiance to pixels
+    framebuffer.resolve(toneMapper, x0, y0, x1, y1);
+}
+
+void Renderer::flushStats() const {
+    RenderStats& local = RenderStats::local();
+    std::lock_guard<std::mutex> lock(statsMutex);
+    frameStats.merge(local);
+    local.reset();
+}
+
+void Renderer::updateToneMapper() const {
+    if (!(toneMapper.getSettings() == settings.toneMap)) {
+        toneMapper = ToneMapper(settings.toneMap);
+    }
+}
+
+void Renderer::resolve(Framebuffer& framebuffer, ThreadPool& pool) const {
+    updateToneMapper();
+    const int rows = (framebuffer.height + TILE_SIZE - 1) / TILE_SIZE;
+    pool.parallelFor(rows, [&](int row) {
+        int y0 = row * TILE_SIZE;
+        framebuffer.resolve(toneMapper, 0, y0, framebuffer.width, std::min(y0 + TILE_SIZE, framebuffer.height));
+    });
+}
+
+RenderStats Renderer::getStats() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return frameStats;
+}
+
+void Renderer::render(Framebuffer& framebuffer, const Camera& camera, ThreadPool& pool, glm::vec2 subpixel) const {
+    renderPass(framebuffer, camera, pool, 1, 0, subpixel);
+}
+
+Renderer::View Renderer::makeView(const Camera& camera, int width, int height) const {
+    View view;
+    view.subpixel = glm::vec2(0.5f);
+    view.step = 1;
+    view.skipStep = 0;
+    view.mask = nullptr;
+    view.depth = nullptr;
+    view.width = width;
+    view.height = height;
+    view.aspectRatio = static_cast<float>(width) / static_cast<float>(height);
+    view.tanHalfFov = tan(settings.fov / 2.0f);
+    view.position = camera.position;
+    view.cameraDir = glm::normalize(camera.target - camera.position);
+    view.cameraX = glm::normalize(glm::cross(view.cameraDir, camera.up));
+    view.cameraY = glm::normalize(glm::cross(view.cameraX, view.cameraDir));
+    return view;
+}
+
+void Renderer::renderPass(Framebuffer& framebuffer, const Camera& camera, ThreadPool& pool,
+                          int step, int skipStep, glm::vec2 subpixel) const {
+    View view = makeView(camera, framebuffer.width, framebuffer.height);
+    view.subpixel = subpixel;
+    view.step = step;
+    view.skipStep = skipStep;
+    renderView(framebuffer, view, pool);
+}
+
+void Renderer::renderSelected(Framebuffer& framebuffer, const Camera& camera, ThreadPool& pool,
+                              const std::vector<uint8_t>& mask, std::vector<float>& depth) const {
+    View view = makeView(camera, framebuffer.width, framebuffer.height);
+    view.mask = mask.data();
+    view.depth = depth.data();
+    renderView(framebuffer, view, pool);
+}
+
+void Renderer::renderView(Framebuffer& framebuffer, const View& view, ThreadPool& pool) const {
+    const int tilesX = (view.width + TILE_SIZE - 1) / TILE_SIZE;
+    const int tilesY = (view.height + TILE_SIZE - 1) / TILE_SIZE;
+    // Leftovers from castRay calls made outside a frame do not belong to this one
+    RenderStats::local().reset();
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        frameStats.reset();
+    }
+    updateToneMapper();
+
+    pool.parallelFor(tilesX * tilesY, [&](int tile) {
+        renderTile(tile, view, framebuffer);
+        flushStats();
+    });
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "glm/glm.hpp"
+#include "camera.h"
+#include "color.h"
+#include "framebuffer.h"
+#include "hdrColor.h"
+#include "intersect.h"
+#include "light.h"
+#include "object.h"
+#include "rayPacket.h"
+#include "renderStats.h"
+#include "scene.h"
+#include "skybox.h"
+#include "threadPool.h"
+#include "toneMap.h"
+
+struct RenderSettings {
+    int maxRecursion = 3;
+    float fov = 3.1415f / 3;
+    bool usePackets = true;
+    ToneMapSettings toneMap;
+};
+
+// Whitted-style ray tracer over a built Scene. Renders into a caller-owned
+// Framebuffer, so it needs no window or SDL renderer. Shading runs on linear HDRColor
+// radiance, every tile is tone mapped into 8-bit pixels once it is finished.
+class Renderer {
+public:
+    static const int TILE_SIZE = 16;
+
+    Renderer(const Scene& scene, const Light& light, const Skybox& skybox);
+
+    // Traces the whole framebuffer from the camera, TILE_SIZE tiles in parallel on the pool.
+    // subpixel is where inside each pixel the primary ray passes, the center by default.
+    void render(Framebuffer& framebuffer, const Camera& camera, ThreadPool& pool,
+                glm::vec2 subpixel = glm::vec2(0.5f)) const;
+
+    // Progressive pass: traces only the pixels on a `step` grid (a power of two up to TILE_SIZE),
+    // skipping those on the `skipStep` grid that a coarser pass already traced (0 = none), and
+    // fills every step x step block from its top-left sample. step 1 finishes the frame.
+    void renderPass(Framebuffer& framebuffer, const Camera& camera, ThreadPool& pool,
+                    int step, int skipStep, glm::vec2 subpixel = glm::vec2(0.5f)) const;
+
+    // Traces only the pixels whose mask entry is non-zero and writes their primary hit
+    // distance to depth, infinity where the ray reached the sky. Other pixels are left alone.
+    void renderSelected(Framebuffer& framebuffer, const Camera& camera, ThreadPool& pool,
+                        const std::vector<uint8_t>& mask, std::vector<float>& depth) const;
+
+    // Camera basis and image size for one frame, plus what the current pass should trace
+    struct View {
+        glm::vec3 position;
+        glm::vec3 cameraDir;
+        glm::vec3 cameraX;
+        glm::vec3 cameraY;
+        float tanHalfFov;
+        float aspectRatio;
+        glm::vec2 subpixel;
+        int step;
+        int skipStep;
+        const uint8_t* mask;  // when set, only pixels with a non-zero entry are traced
+        float* depth;  // when set, receives each traced pixel's primary hit distance
+        int width;
+        int height;
+
+        glm::vec3 primaryRay(int x, int y) const;
+
+        // Inverse of primaryRay: continuous pixel coordinates of a world point. False behind the camera.
+        bool project(const glm::vec3& point, float& x, float& y) const;
+    };
+
+    View makeView(const Camera& camera, int width, int height) const;
+
+    // Tone maps the whole radiance buffer into pixels again, for radiance written outside a render
+    void resolve(Framebuffer& framebuffer, ThreadPool& pool) const;
+
+    // Scalar path, used for single rays and for the incoherent reflection/refraction bounces
+    // hitDistance receives the distance to the first hit, infinity when the sky was returned.
+    HDRColor castRay(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, const short recursion = 0,
+                     float* hitDistance = nullptr) const;
+
+    // Counters of the last render() call, summed over all threads
+    RenderStats getStats() const;
+
+    RenderSettings settings;
+
+private:
+    float castShadow(const glm::vec3& shadowOrigin, const glm::vec3& lightDir, const Object* hitObject) const;
+    HDRColor shade(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, const Intersect& intersect,
+                   const Object* hitObject, float shadowIntensity, const short recursion) const;
+    void castPacket(const RayPacket& primary, HDRColor colors[RayPacket::SIZE], float distances[RayPacket::SIZE]) const;
+    void renderView(Framebuffer& framebuffer, const View& view, ThreadPool& pool) const;
+    void renderTile(int tile, const View& view, Framebuffer& framebuffer) const;
+    void flushStats() const;  // moves the calling thread's counters into frameStats
+    void updateToneMapper() const;  // rebuilds toneMapper when settings.toneMap changed
+
+    const Scene& scene;
+    const Light& light;
+    const Skybox& skybox;
+
+    mutable std::mutex statsMutex;
+    mutable RenderStats frameStats;
+    mutable ToneMapper toneMapper;
+};
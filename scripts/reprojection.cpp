@@ -0,0 +1,115 @@
+#include "reprojection.h"
+#include <bit>
+#include <cmath>
+#include <limits>
+
+namespace {
+    const float INF = std::numeric_limits<float>::infinity();
+    const uint64_t EMPTY_SPLAT = ~0ull;
+
+    // Cheap per pixel and frame hash, picks a different set of refresh pixels every frame
+    uint32_t hashPixel(uint32_t pixel, uint32_t frame) {
+        uint32_t h = pixel * 0x9E3779B1u ^ frame * 0x85EBCA77u;
+        h ^= h >> 15;
+        h *= 0x2C1B3C6Du;
+        h ^= h >> 12;
+        return h;
+    }
+}
+
+ReprojectionCache::ReprojectionCache(int width, int height)
+        : width(width), height(height) {
+    const size_t count = static_cast<size_t>(width) * height;
+    positions.resize(count);
+    depth.assign(count, INF);
+    colors.resize(count);
+    nextPositions.resize(count);
+    nextDepth.resize(count);
+    mask.resize(count);
+    splat = std::vector<std::atomic<uint64_t>>(count);
+    for (std::atomic<uint64_t>& s : splat) {
+        s.store(EMPTY_SPLAT, std::memory_order_relaxed);
+    }
+}
+
+void ReprojectionCache::render(const Renderer& renderer, Framebuffer& framebuffer, const Camera& camera,
+                               const ViewState& state, ThreadPool& pool) {
+    const size_t count = mask.size();
+    Renderer::View view = renderer.makeView(camera, width, height);
+    frame++;
+
+    const bool reuse = valid && state.sameShading(cached);
+    if (reuse) {
+        // Splat every old pixel into the pixel it lands on now. Surface hits keep the nearest one,
+        // sky pixels are directions at infinity and only fill what no surface covered. Equal
+        // keys go to the lowest source pixel, so the result does not depend on thread timing.
+        pool.parallelFor(height, [&](int row) {
+            const size_t end = static_cast<size_t>(row + 1) * width;
+            for (size_t i = static_cast<size_t>(row) * width; i < end; i++) {
+                bool sky = depth[i] == INF;
+                float fx;
+                float fy;
+                if (!view.project(sky ? view.position + positions[i] : positions[i], fx, fy)) {
+                    continue;
+                }
+                int x = static_cast<int>(std::lround(fx));
+                int y = static_cast<int>(std::lround(fy));
+                if (x < 0 || y < 0 || x >= width || y >= height) {
+                    continue;
+                }
+                size_t target = static_cast<size_t>(y) * width + x;
+                float distance = sky ? INF : glm::length(positions[i] - view.position);
+                // Non-negative floats order like their bit patterns
+                uint64_t key = static_cast<uint64_t>(std::bit_cast<uint32_t>(distance)) << 32 | static_cast<uint32_t>(i);
+                uint64_t current = splat[target].load(std::memory_order_relaxed);
+                while (key < current && !splat[target].compare_exchange_weak(current, key, std::memory_order_relaxed)) {
+                }
+            }
+        });
+    }
+
+    // Take the winning splat of every pixel, or mark it for tracing, and pick the refresh pixels
+    const uint32_t refreshThreshold = static_cast<uint32_t>(glm::clamp(refreshRatio, 0.0f, 1.0f) * 4294967295.0f);
+    std::atomic<size_t> reused{0};
+    pool.parallelFor(height, [&](int row) {
+        size_t rowReused = 0;
+        const size_t end = static_cast<size_t>(row + 1) * width;
+        for (size_t i = static_cast<size_t>(row) * width; i < end; i++) {
+            uint64_t key = splat[i].load(std::memory_order_relaxed);
+            if (key == EMPTY_SPLAT) {
+                nextDepth[i] = INF;
+                mask[i] = 1;
+                continue;
+            }
+            splat[i].store(EMPTY_SPLAT, std::memory_order_relaxed);
+            uint32_t source = static_cast<uint32_t>(key);
+            nextDepth[i] = std::bit_cast<float>(static_cast<uint32_t>(key >> 32));
+            nextPositions[i] = positions[source];
+            framebuffer.radiance[i] = colors[source];
+            mask[i] = hashPixel(static_cast<uint32_t>(i), frame) < refreshThreshold;
+            rowReused += !mask[i];
+        }
+        reused.fetch_add(rowReused, std::memory_order_relaxed);
+    });
+
+    renderer.renderSelected(framebuffer, camera, pool, mask, nextDepth);
+
+    // Traced pixels get their hit position (or sky direction) back from the ray,
+    // reused ones keep the splatted point so errors do not build up over frames
+    pool.parallelFor(height, [&](int y) {
+        for (int x = 0; x < width; x++) {
+            size_t i = static_cast<size_t>(y) * width + x;
+            if (mask[i]) {
+                glm::vec3 direction = view.primaryRay(x, y);
+                nextPositions[i] = nextDepth[i] == INF ? direction : view.position + direction * nextDepth[i];
+            }
+            colors[i] = framebuffer.radiance[i];
+        }
+    });
+
+    positions.swap(nextPositions);
+    depth.swap(nextDepth);
+    cached = state;
+    valid = true;
+    lastReuse = static_cast<double>(reused.load()) / count;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+#include "camera.h"
+#include "frameCache.h"
+#include "framebuffer.h"
+#include "renderer.h"
+#include "threadPool.h"
+
+// Temporal reprojection for small camera moves. Keeps the primary hit position, distance
+// and shaded color of every pixel of the last frame, splats them into the new view and
+// only traces the pixels nothing landed on, plus a random share of refresh pixels.
+// Reflections and highlights move with the view, so reused pixels are approximate.
+class ReprojectionCache {
+public:
+    ReprojectionCache(int width, int height);
+
+    // Fraction of reused pixels traced again anyway each frame, so stale colors fade out
+    float refreshRatio = 0.02f;
+
+    // Renders the camera into framebuffer. Everything is traced when there is no previous
+    // frame or when anything besides the camera changed since it.
+    void render(const Renderer& renderer, Framebuffer& framebuffer, const Camera& camera,
+                const ViewState& state, ThreadPool& pool);
+
+    // Forces the next render() to trace every pixel
+    void invalidate() { valid = false; }
+
+    // Share of pixels in the last render() that were reused instead of traced
+    double reuseRatio() const { return lastReuse; }
+
+private:
+    int width;
+    int height;
+    bool valid = false;
+    ViewState cached{};
+    uint32_t frame = 0;
+    double lastReuse = 0.0;
+
+    std::vector<glm::vec3> positions;  // world space primary hit, or the ray direction where depth is infinite
+    std::vector<float> depth;  // distance from the camera, infinity for sky
+    std::vector<HDRColor> colors;
+
+    // Scratch for the next frame
+    std::vector<glm::vec3> nextPositions;
+    std::vector<float> nextDepth;
+    std::vector<uint8_t> mask;
+    // Nearest splat per pixel as (depth bits << 32 | source pixel), so threads resolve it with an
+    // atomic min. Left at EMPTY_SPLAT between frames.
+    std::vector<std::atomic<uint64_t>> splat;
+};
@@ -0,0 +1,9 @@
+#include "scene.h"
+
+void Scene::build(const std::vector<Object*>& objects) {
+    primitives.clear();
+    std::vector<PrimitiveRef> refs = primitives.add(objects);
+    bvh.build(primitives, refs);
+    mapping.reset();
+    revision++;
+}
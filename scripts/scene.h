@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "object.h"
+#include "primitives.h"
+#include "bvh.h"
+#include "mappedFile.h"
+
+// Render-time copy of the scene: typed primitive arrays plus the BVH built over them
+class Scene {
+public:
+    PrimitiveStore primitives;
+    BVH bvh;
+    uint64_t revision = 0;  // bumped by every build() so cached frames can tell the scene changed
+    std::unique_ptr<MappedFile> mapping;  // compiled scene the BVH reads from, see sceneCache.h
+
+    Scene() = default;
+    Scene(const Scene&) = delete;
+    Scene& operator=(const Scene&) = delete;
+
+    // Copies the objects into typed storage and rebuilds the BVH
+    void build(const std::vector<Object*>& objects);
+
+    // Shadow-ray query: the nearest hit other than `ignore` within BIAS <= t <= tMax, its distance goes to tHit
+    bool nearestOccluder(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, float tMax,
+                         const Object* ignore, float& tHit) const {
+        return bvh.nearestOccluder(rayOrigin, rayDirection, tMax, ignore, tHit);
+    }
+};
@@ -0,0 +1,347 @@
+#include "sceneCache.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "mappedFile.h"
+
+namespace {
+    const char MAGIC[8] = {'R', 'T', 'S', 'C', 'E', 'N', 'E', '\0'};
+    const uint32_t VERSION = 2;  // 2 stores the BVH depth, older trees may be too deep to traverse
+    const size_t ALIGNMENT = 64;
+
+    struct CubeRecord {
+        glm::vec3 minCorner;
+        glm::vec3 maxCorner;
+        uint32_t material;
+    };
+
+    struct SphereRecord {
+        glm::vec3 center;
+        float radius;
+        uint32_t material;
+    };
+
+    enum Section {
+        MATERIALS,
+        CUBES,
+        SPHERES,
+        NODES,
+        REFS,
+        BOUNDS,  // six BoxSoA component arrays back to back, each boxes + LANES floats
+        SKYBOX,
+        SECTION_COUNT
+    };
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t layout;
+        uint64_t sourceHash;
+        uint32_t hasCamera;
+        uint32_t hasLight;
+        uint32_t bvhDepth;
+        glm::vec3 eye;
+        glm::vec3 target;
+        glm::vec3 up;
+        float rotationSpeed;
+        Light light;
+        uint64_t count[SECTION_COUNT];  // elements, boxes for BOUNDS, bytes for SKYBOX
+        uint64_t offset[SECTION_COUNT];
+    };
+
+    static_assert(std::is_trivially_copyable_v<Material> && std::is_trivially_copyable_v<BVHNode> &&
+                  std::is_trivially_copyable_v<PrimitiveRef> && std::is_trivially_copyable_v<Light>,
+                  "compiled scene sections are copied as raw bytes");
+
+    // Changes whenever a stored struct changes size, so files from another build are rejected
+    uint32_t layoutTag() {
+        return static_cast<uint32_t>(sizeof(BVHNode)) | static_cast<uint32_t>(sizeof(PrimitiveRef)) << 8 |
+               static_cast<uint32_t>(sizeof(Material)) << 16 | static_cast<uint32_t>(BoxSoA::LANES) << 24;
+    }
+
+    size_t elementSize(int section) {
+        switch (section) {
+            case MATERIALS: return sizeof(Material);
+            case CUBES: return sizeof(CubeRecord);
+            case SPHERES: return sizeof(SphereRecord);
+            case NODES: return sizeof(BVHNode);
+            case REFS: return sizeof(PrimitiveRef);
+            case BOUNDS: return 6 * sizeof(float);
+            default: return 1;
+        }
+    }
+
+    size_t sectionBytes(const Header& header, int section) {
+        uint64_t elements = header.count[section];
+        if (section == BOUNDS) {
+            elements += BoxSoA::LANES;
+        }
+        return static_cast<size_t>(elements) * elementSize(section);
+    }
+
+    void append(std::vector<unsigned char>& out, Header& header, int section, const void* data, size_t bytes) {
+        out.resize((out.size() + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT);
+        header.offset[section] = out.size();
+        const unsigned char* begin = static_cast<const unsigned char*>(data);
+        out.insert(out.end(), begin, begin + bytes);
+    }
+
+    // Checks what traversal trusts without bounds checks: every ref names an existing cube or
+    // sphere, every leaf range lies inside the refs, every child inside the nodes, and the tree
+    // is acyclic and shallow enough for BVH::STACK_SIZE. One walk from the root finds the depth,
+    // a node reached twice means a cycle or a shared subtree.
+    bool validBVH(const Header& header, const BVHNode* nodes, const PrimitiveRef* refs, int& depth) {
+        const uint64_t nodeCount = header.count[NODES];
+        const uint64_t refCount = header.count[REFS];
+        if (header.count[BOUNDS] != refCount || nodeCount > INT32_MAX || refCount > INT32_MAX) {
+            return false;
+        }
+        for (uint64_t i = 0; i < refCount; i++) {
+            bool valid = (refs[i].type == PrimitiveType::Cube && refs[i].index < header.count[CUBES]) ||
+                         (refs[i].type == PrimitiveType::Sphere && refs[i].index < header.count[SPHERES]);
+            if (!valid) {
+                return false;
+            }
+        }
+
+        depth = 0;
+        if (nodeCount == 0) {
+            return refCount == 0;
+        }
+        std::vector<uint8_t> reached(nodeCount, 0);
+        std::vector<std::pair<int, int>> stack = {{0, 0}};  // node, level
+        while (!stack.empty()) {
+            auto [index, level] = stack.back();
+            stack.pop_back();
+            if (reached[index] || level >= BVH::STACK_SIZE) {
+                return false;
+            }
+            reached[index] = 1;
+            depth = std::max(depth, level);
+
+            const BVHNode& node = nodes[index];
+            if (node.count < 0 || node.first < 0) {
+                return false;
+            }
+            if (node.count == 0) {
+                if (node.boxesOnly || static_cast<uint64_t>(node.first) + 1 >= nodeCount) {
+                    return false;
+                }
+                stack.push_back({node.first, level + 1});
+                stack.push_back({node.first + 1, level + 1});
+                continue;
+            }
+            if (static_cast<uint64_t>(node.first) + static_cast<uint64_t>(node.count) > refCount) {
+                return false;
+            }
+            bool boxesOnly = true;
+            for (int i = node.first; i < node.first + node.count; i++) {
+                boxesOnly = boxesOnly && refs[i].type == PrimitiveType::Cube;
+            }
+            if (node.boxesOnly != boxesOnly) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    uint32_t materialIndex(const Material& material, std::vector<Material>& materials,
+                           std::unordered_map<std::string, uint32_t>& indices) {
+        std::string key(reinterpret_cast<const char*>(&material), sizeof(Material));
+        auto it = indices.find(key);
+        if (it != indices.end()) {
+            return it->second;
+        }
+        uint32_t index = static_cast<uint32_t>(materials.size());
+        materials.push_back(material);
+        indices.emplace(std::move(key), index);
+        return index;
+    }
+}
+
+bool hashFile(const std::string& path, uint64_t& hash) {
+    MappedFile file;
+    if (!file.open(path)) {
+        // An empty file cannot be mapped but still has a hash
+        std::ifstream stream(path, std::ios::binary);
+        if (!stream || stream.peek() != std::ifstream::traits_type::eof()) {
+            return false;
+        }
+        hash = 0xcbf29ce484222325ull;
+        return true;
+    }
+
+    // FNV-1a style mixing eight bytes at a time, plus the length
+    const uint64_t prime = 0x100000001b3ull;
+    uint64_t h = 0xcbf29ce484222325ull ^ file.size();
+    const unsigned char* data = file.data();
+    size_t i = 0;
+    for (; i + 8 <= file.size(); i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        h = (h ^ word) * prime;
+        h ^= h >> 29;
+    }
+    for (; i < file.size(); i++) {
+        h = (h ^ data[i]) * prime;
+    }
+    hash = h;
+    return true;
+}
+
+bool writeCompiledScene(const std::string& path, uint64_t sourceHash,
+                        const SceneDescription& description, const Scene& scene) {
+    // Voxel grids have no record type yet
+    if (!scene.primitives.voxels.empty()) {
+        return false;
+    }
+
+    Header header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.layout = layoutTag();
+    header.sourceHash = sourceHash;
+    header.hasCamera = description.hasCamera;
+    header.hasLight = description.hasLight;
+    header.bvhDepth = static_cast<uint32_t>(scene.bvh.getDepth());
+    header.eye = description.camera.position;
+    header.target = description.camera.target;
+    header.up = description.camera.up;
+    header.rotationSpeed = description.camera.rotationSpeed;
+    header.light = description.light;
+
+    std::vector<Material> materials;
+    std::unordered_map<std::string, uint32_t> indices;
+    std::vector<CubeRecord> cubes;
+    cubes.reserve(scene.primitives.cubes.size());
+    for (const Cube& cube : scene.primitives.cubes) {
+        cubes.push_back(CubeRecord{cube.getMinCorner(), cube.getMaxCorner(), materialIndex(cube.material, materials, indices)});
+    }
+    std::vector<SphereRecord> spheres;
+    spheres.reserve(scene.primitives.spheres.size());
+    for (const Sphere& sphere : scene.primitives.spheres) {
+        spheres.push_back(SphereRecord{sphere.getCenter(), sphere.getRadius(), materialIndex(sphere.material, materials, indices)});
+    }
+
+    std::span<const BVHNode> nodes = scene.bvh.getNodes();
+    std::span<const PrimitiveRef> refs = scene.bvh.getPrimitives();
+    const BoxSoA& bounds = scene.bvh.getPrimitiveBounds();
+
+    header.count[MATERIALS] = materials.size();
+    header.count[CUBES] = cubes.size();
+    header.count[SPHERES] = spheres.size();
+    header.count[NODES] = nodes.size();
+    header.count[REFS] = refs.size();
+    header.count[BOUNDS] = bounds.size();
+    header.count[SKYBOX] = description.skybox.size();
+
+    std::vector<unsigned char> out(sizeof(Header));
+    append(out, header, MATERIALS, materials.data(), sectionBytes(header, MATERIALS));
+    append(out, header, CUBES, cubes.data(), sectionBytes(header, CUBES));
+    append(out, header, SPHERES, spheres.data(), sectionBytes(header, SPHERES));
+    append(out, header, NODES, nodes.data(), sectionBytes(header, NODES));
+    append(out, header, REFS, refs.data(), sectionBytes(header, REFS));
+
+    out.resize((out.size() + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT);
+    header.offset[BOUNDS] = out.size();
+    const size_t componentBytes = (bounds.size() + BoxSoA::LANES) * sizeof(float);
+    for (const float* component : {bounds.minX, bounds.minY, bounds.minZ, bounds.maxX, bounds.maxY, bounds.maxZ}) {
+        const unsigned char* begin = reinterpret_cast<const unsigned char*>(component);
+        out.insert(out.end(), begin, begin + componentBytes);
+    }
+
+    append(out, header, SKYBOX, description.skybox.data(), description.skybox.size());
+    std::memcpy(out.data(), &header, sizeof(Header));
+
+    // Write next to the target and rename, so a crash never leaves a half written cache behind
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()))) {
+            return false;
+        }
+    }
+    std::remove(path.c_str());
+    return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+bool loadCompiledScene(const std::string& path, uint64_t sourceHash, Scene& scene, SceneDescription& description) {
+    auto file = std::make_unique<MappedFile>();
+    if (!file->open(path) || file->size() < sizeof(Header)) {
+        return false;
+    }
+
+    Header header;
+    std::memcpy(&header, file->data(), sizeof(Header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+        header.layout != layoutTag() || header.sourceHash != sourceHash) {
+        return false;
+    }
+    for (int section = 0; section < SECTION_COUNT; section++) {
+        // Every element takes at least a byte, which also keeps the byte count below from overflowing
+        if (header.count[section] > file->size()) {
+            return false;
+        }
+        size_t bytes = sectionBytes(header, section);
+        if (header.offset[section] > file->size() || bytes > file->size() - header.offset[section] ||
+            (section != SKYBOX && header.offset[section] % alignof(float) != 0)) {
+            return false;
+        }
+    }
+
+    const unsigned char* base = file->data();
+    auto section = [&](int index) { return base + header.offset[index]; };
+    const Material* materials = reinterpret_cast<const Material*>(section(MATERIALS));
+    const CubeRecord* cubes = reinterpret_cast<const CubeRecord*>(section(CUBES));
+    const SphereRecord* spheres = reinterpret_cast<const SphereRecord*>(section(SPHERES));
+    const BVHNode* nodes = reinterpret_cast<const BVHNode*>(section(NODES));
+    const PrimitiveRef* refs = reinterpret_cast<const PrimitiveRef*>(section(REFS));
+    int depth;
+    if (!validBVH(header, nodes, refs, depth) || header.bvhDepth != static_cast<uint32_t>(depth)) {
+        return false;
+    }
+    const uint64_t materialCount = header.count[MATERIALS];
+    for (uint64_t i = 0; i < header.count[CUBES]; i++) {
+        if (cubes[i].material >= materialCount) {
+            return false;
+        }
+    }
+    for (uint64_t i = 0; i < header.count[SPHERES]; i++) {
+        if (spheres[i].material >= materialCount) {
+            return false;
+        }
+    }
+
+    // Objects carry a vtable, so they are the one thing that cannot be used straight from the file
+    scene.primitives.clear();
+    scene.primitives.cubes.reserve(header.count[CUBES]);
+    for (uint64_t i = 0; i < header.count[CUBES]; i++) {
+        scene.primitives.cubes.emplace_back(cubes[i].minCorner, cubes[i].maxCorner, materials[cubes[i].material]);
+    }
+    scene.primitives.spheres.reserve(header.count[SPHERES]);
+    for (uint64_t i = 0; i < header.count[SPHERES]; i++) {
+        scene.primitives.spheres.emplace_back(spheres[i].center, spheres[i].radius, materials[spheres[i].material]);
+    }
+
+    const size_t components = header.count[BOUNDS] + BoxSoA::LANES;
+    const float* bounds = reinterpret_cast<const float*>(section(BOUNDS));
+    const float* arrays[6];
+    for (int i = 0; i < 6; i++) {
+        arrays[i] = bounds + i * components;
+    }
+    scene.bvh.attach(scene.primitives, std::span<const BVHNode>(nodes, header.count[NODES]),
+                     std::span<const PrimitiveRef>(refs, header.count[REFS]), arrays, depth);
+    scene.mapping = std::move(file);
+    scene.revision++;
+
+    description.objects.clear();
+    description.hasCamera = header.hasCamera != 0;
+    description.camera = Camera(header.eye, header.target, header.up, header.rotationSpeed);
+    description.hasLight = header.hasLight != 0;
+    description.light = header.light;
+    description.skybox.assign(reinterpret_cast<const char*>(section(SKYBOX)), header.count[SKYBOX]);
+    return true;
+}
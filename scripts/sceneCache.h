@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "scene.h"
+#include "sceneLoader.h"
+
+// Compiled scenes: the material table, the typed primitive arrays and the BVH of a text
+// scene, written once and memory-mapped at startup. The BVH is used in place from the
+// mapping, primitives are constructed into their typed arrays in one pass.
+// A compiled scene records the content hash of the text it came from and the struct
+// layout of the build that wrote it; a mismatch in either makes it stale.
+
+// 64-bit content hash of a whole file. False when it cannot be read.
+bool hashFile(const std::string& path, uint64_t& hash);
+
+// Writes scene (already built) plus the camera, light and skybox of description
+bool writeCompiledScene(const std::string& path, uint64_t sourceHash,
+                        const SceneDescription& description, const Scene& scene);
+
+// Maps path and attaches it to scene, which keeps the mapping alive. Camera, light and
+// skybox go to description, which gets no objects. False when the file is missing,
+// stale or damaged; scene is left untouched then.
+bool loadCompiledScene(const std::string& path, uint64_t sourceHash, Scene& scene, SceneDescription& description);
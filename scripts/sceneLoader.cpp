@@ -0,0 +1,268 @@
+#include "sceneLoader.h"
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include "cube.h"
+#include "sphere.h"
+
+namespace {
+    const size_t CHUNK_SIZE = 1 << 20;
+    const int MAX_FIELDS = 16;
+
+    struct ParseError {
+        std::string message;
+    };
+
+    struct Statement {
+        std::string_view fields[MAX_FIELDS];
+        int count = 0;
+    };
+
+    bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    Statement split(std::string_view line) {
+        Statement statement;
+        size_t i = 0;
+        while (i < line.size()) {
+            while (i < line.size() && isSpace(line[i])) {
+                i++;
+            }
+            if (i == line.size() || line[i] == '#') {
+                break;
+            }
+            size_t start = i;
+            while (i < line.size() && !isSpace(line[i]) && line[i] != '#') {
+                i++;
+            }
+            if (statement.count == MAX_FIELDS) {
+                throw ParseError{"too many fields"};
+            }
+            statement.fields[statement.count++] = line.substr(start, i - start);
+        }
+        return statement;
+    }
+
+    // Plain decimals with at most 7 digits: mantissa and power of ten are both exact floats,
+    // so a single division rounds exactly like from_chars does (Clinger's fast path)
+    bool fastNumber(std::string_view field, float& value) {
+        static const float powers[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f};
+        size_t i = 0;
+        bool negative = false;
+        if (i < field.size() && (field[i] == '-' || field[i] == '+')) {
+            negative = field[i] == '-';
+            i++;
+        }
+        int mantissa = 0;
+        int digits = 0;
+        int decimals = 0;
+        bool point = false;
+        for (; i < field.size(); i++) {
+            char c = field[i];
+            if (c >= '0' && c <= '9') {
+                if (++digits > 7) {
+                    return false;
+                }
+                mantissa = mantissa * 10 + (c - '0');
+                decimals += point;
+            } else if (c == '.' && !point) {
+                point = true;
+            } else {
+                return false;
+            }
+        }
+        if (digits == 0) {
+            return false;
+        }
+        value = static_cast<float>(mantissa) / powers[decimals];
+        if (negative) {
+            value = -value;
+        }
+        return true;
+    }
+
+    float number(std::string_view field) {
+        float value;
+        if (fastNumber(field, value)) {
+            return value;
+        }
+        const char* end = field.data() + field.size();
+        auto result = std::from_chars(field.data(), end, value);
+        if (result.ec != std::errc() || result.ptr != end) {
+            throw ParseError{"'" + std::string(field) + "' is not a number"};
+        }
+        return value;
+    }
+
+    glm::vec3 vec3(const Statement& statement, int first) {
+        return glm::vec3(number(statement.fields[first]), number(statement.fields[first + 1]),
+                         number(statement.fields[first + 2]));
+    }
+
+    int channel(std::string_view field) {
+        float value = number(field);
+        if (value < 0.0f || value > 255.0f) {
+            throw ParseError{"color channel " + std::string(field) + " is outside 0-255"};
+        }
+        return static_cast<int>(value);
+    }
+
+    void expect(const Statement& statement, int minFields, int maxFields, const char* usage) {
+        if (statement.count < minFields || statement.count > maxFields) {
+            throw ParseError{std::string(statement.fields[0]) + " expects " + usage + ", got " +
+                             std::to_string(statement.count - 1) + " fields"};
+        }
+    }
+
+    class Parser {
+    public:
+        Parser(SceneDescription& scene, const std::string& directory) : scene(scene), directory(directory) {}
+
+        void parse(std::string_view line) {
+            Statement statement = split(line);
+            if (statement.count == 0) {
+                return;
+            }
+            std::string_view keyword = statement.fields[0];
+            if (keyword == "cube") {
+                expect(statement, 8, 8, "<material> <min x y z> <max x y z>");
+                glm::vec3 min = vec3(statement, 2);
+                glm::vec3 max = vec3(statement, 5);
+                scene.objects.push_back(new Cube(min, max, material(statement.fields[1])));
+            } else if (keyword == "sphere") {
+                expect(statement, 6, 6, "<material> <center x y z> <radius>");
+                glm::vec3 center = vec3(statement, 2);
+                float radius = number(statement.fields[5]);
+                if (!(radius > 0.0f)) {
+                    throw ParseError{"sphere radius must be positive"};
+                }
+                scene.objects.push_back(new Sphere(center, radius, material(statement.fields[1])));
+            } else if (keyword == "material") {
+                expect(statement, 10, 11, "<name> <r g b> <albedo> <specularAlbedo> <specularCoefficient> "
+                                          "<reflectivity> <transparency> [refractionIndex]");
+                std::string name(statement.fields[1]);
+                Material mat = {
+                        Color(channel(statement.fields[2]), channel(statement.fields[3]), channel(statement.fields[4])),
+                        number(statement.fields[5]),
+                        number(statement.fields[6]),
+                        number(statement.fields[7]),
+                        number(statement.fields[8]),
+                        number(statement.fields[9]),
+                        statement.count == 11 ? number(statement.fields[10]) : 0.0f
+                };
+                if (!scene.materials.emplace(name, mat).second) {
+                    throw ParseError{"material '" + name + "' is already defined"};
+                }
+            } else if (keyword == "light") {
+                expect(statement, 8, 8, "<x y z> <intensity> <r g b>");
+                scene.light = Light{vec3(statement, 1), number(statement.fields[4]),
+                                    Color(channel(statement.fields[5]), channel(statement.fields[6]),
+                                          channel(statement.fields[7]))};
+                scene.hasLight = true;
+            } else if (keyword == "camera") {
+                expect(statement, 11, 11, "<eye x y z> <target x y z> <up x y z> <rotationSpeed>");
+                scene.camera = Camera(vec3(statement, 1), vec3(statement, 4), vec3(statement, 7),
+                                      number(statement.fields[10]));
+                scene.hasCamera = true;
+            } else if (keyword == "skybox") {
+                expect(statement, 2, 2, "<path>");
+                std::string file(statement.fields[1]);
+                bool absolute = file[0] == '/' || file[0] == '\\' || (file.size() > 1 && file[1] == ':');
+                scene.skybox = absolute ? file : directory + file;
+            } else {
+                throw ParseError{"unknown statement '" + std::string(keyword) + "'"};
+            }
+        }
+
+    private:
+        // Primitives usually come in runs with the same material, so remember the last lookup
+        const Material& material(std::string_view name) {
+            if (lastMaterial && name == lastName) {
+                return *lastMaterial;
+            }
+            auto it = scene.materials.find(std::string(name));
+            if (it == scene.materials.end()) {
+                throw ParseError{"unknown material '" + std::string(name) + "', define it with a material line first"};
+            }
+            lastName = it->first;
+            lastMaterial = &it->second;
+            return *lastMaterial;
+        }
+
+        SceneDescription& scene;
+        std::string directory;
+        std::string lastName;
+        const Material* lastMaterial = nullptr;
+    };
+}
+
+SceneDescription loadScene(const std::string& path) {
+    std::unique_ptr<FILE, int (*)(FILE*)> file(std::fopen(path.c_str(), "rb"), std::fclose);
+    if (!file) {
+        throw std::runtime_error(path + ": could not open scene file");
+    }
+
+    size_t slash = path.find_last_of("/\\");
+    SceneDescription scene;
+    Parser parser(scene, slash == std::string::npos ? std::string() : path.substr(0, slash + 1));
+
+    // Lines are parsed straight out of the read buffer, only a line cut by the chunk
+    // boundary is carried over to the next read
+    std::vector<char> buffer(CHUNK_SIZE);
+    size_t carried = 0;
+    int lineNumber = 0;
+    try {
+        while (true) {
+            size_t read = std::fread(buffer.data() + carried, 1, buffer.size() - carried, file.get());
+            size_t available = carried + read;
+            bool lastChunk = read == 0;
+            std::string_view data(buffer.data(), available);
+
+            size_t start = 0;
+            while (true) {
+                size_t end = data.find('\n', start);
+                if (end == std::string_view::npos) {
+                    if (!lastChunk) {
+                        break;
+                    }
+                    end = available;
+                    if (start == end) {
+                        break;
+                    }
+                }
+                lineNumber++;
+                parser.parse(data.substr(start, end - start));
+                start = end + 1;
+                if (start >= available) {
+                    break;
+                }
+            }
+            if (lastChunk) {
+                break;
+            }
+
+            carried = start < available ? available - start : 0;
+            if (carried == buffer.size()) {
+                buffer.resize(buffer.size() * 2);  // a single line longer than the buffer
+            }
+            std::memmove(buffer.data(), buffer.data() + start, carried);
+        }
+    } catch (const ParseError& error) {
+        for (Object* object : scene.objects) {
+            delete object;
+        }
+        throw std::runtime_error(path + ":" + std::to_string(lineNumber) + ": " + error.message);
+    }
+
+    if (std::ferror(file.get())) {
+        for (Object* object : scene.objects) {
+            delete object;
+        }
+        throw std::runtime_error(path + ": read error");
+    }
+    return scene;
+}
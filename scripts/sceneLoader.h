@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "glm/glm.hpp"
+#include "camera.h"
+#include "light.h"
+#include "material.h"
+#include "object.h"
+
+// Scene files are plain text, one statement per line, fields separated by spaces or tabs.
+// '#' starts a comment. Materials must be defined before the primitives that use them.
+//
+//   skybox   <path>                                  relative to the scene file
+//   camera   <eye x y z> <target x y z> <up x y z> <rotationSpeed>
+//   light    <x y z> <intensity> <r g b>             color channels 0-255
+//   material <name> <r g b> <albedo> <specularAlbedo> <specularCoefficient>
+//            <reflectivity> <transparency> [refractionIndex]
+//   cube     <material> <min x y z> <max x y z>
+//   sphere   <material> <center x y z> <radius>
+struct SceneDescription {
+    std::vector<Object*> objects;  // allocated with new, owned by the caller
+    std::unordered_map<std::string, Material> materials;
+
+    bool hasCamera = false;
+    Camera camera{glm::vec3(0.0f, 0.0f, 15.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f), 10.0f};
+    bool hasLight = false;
+    Light light{glm::vec3(0.0f), 1.0f, Color(255, 255, 255)};
+    std::string skybox;  // empty when the file sets none
+};
+
+// Streams the file in fixed-size chunks. Throws std::runtime_error("path:line: message")
+// on the first malformed statement, after deleting the objects created so far.
+SceneDescription loadScene(const std::string& path);
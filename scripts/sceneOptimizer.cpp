@@ -0,0 +1,272 @@
+#include "sceneOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include "cube.h"
+#include "sphere.h"
+
+namespace {
+    struct Entry {
+        Object* object;
+        AABB box;
+        bool alive = true;
+        bool mergeable = false;  // opaque cube with its corners in min/max order
+    };
+
+    int compareMaterials(const Material& a, const Material& b) {
+        return std::memcmp(&a, &b, sizeof(Material));
+    }
+
+    bool sameMaterial(const Object* a, const Object* b) {
+        return compareMaterials(a->material, b->material) == 0;
+    }
+
+    // Everything an object's hits depend on, in a fixed order, for sorting and equality
+    std::vector<float> shapeKey(const Object* object) {
+        if (object->type == PrimitiveType::Cube) {
+            const Cube* cube = static_cast<const Cube*>(object);
+            const glm::vec3& a = cube->getMinCorner();
+            const glm::vec3& b = cube->getMaxCorner();
+            return {a.x, a.y, a.z, b.x, b.y, b.z};
+        }
+        if (object->type == PrimitiveType::Sphere) {
+            const Sphere* sphere = static_cast<const Sphere*>(object);
+            const glm::vec3& c = sphere->getCenter();
+            return {c.x, c.y, c.z, sphere->getRadius()};
+        }
+        return {};
+    }
+
+    size_t removeDuplicates(std::vector<Entry>& entries) {
+        std::vector<std::vector<float>> keys(entries.size());
+        std::vector<size_t> order;
+        for (size_t i = 0; i < entries.size(); i++) {
+            keys[i] = shapeKey(entries[i].object);
+            if (!keys[i].empty()) {
+                order.push_back(i);
+            }
+        }
+
+        auto less = [&](size_t a, size_t b) {
+            const Object* x = entries[a].object;
+            const Object* y = entries[b].object;
+            if (x->type != y->type) {
+                return x->type < y->type;
+            }
+            if (keys[a] != keys[b]) {
+                return keys[a] < keys[b];
+            }
+            int material = compareMaterials(x->material, y->material);
+            return material != 0 ? material < 0 : a < b;
+        };
+        std::sort(order.begin(), order.end(), less);
+
+        // Equal objects are adjacent with the earliest first, which is the one kept
+        size_t removed = 0;
+        for (size_t i = 1; i < order.size(); i++) {
+            const Entry& kept = entries[order[i - 1]];
+            Entry& entry = entries[order[i]];
+            if (entry.object->type == kept.object->type && keys[order[i]] == keys[order[i - 1]] &&
+                sameMaterial(entry.object, kept.object)) {
+                entry.alive = false;
+                removed++;
+            }
+        }
+        return removed;
+    }
+
+    // One sweep along axis: boxes with the same material and the same extent on the
+    // other two axes are sorted by their start, and touching or overlapping runs fused.
+    size_t mergeAlong(std::vector<Entry>& entries, int axis) {
+        const int u = (axis + 1) % 3;
+        const int v = (axis + 2) % 3;
+        std::vector<size_t> order;
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (entries[i].alive && entries[i].mergeable) {
+                order.push_back(i);
+            }
+        }
+
+        auto sameSlab = [&](const Entry& a, const Entry& b) {
+            return a.box.min[u] == b.box.min[u] && a.box.max[u] == b.box.max[u] &&
+                   a.box.min[v] == b.box.min[v] && a.box.max[v] == b.box.max[v] &&
+                   sameMaterial(a.object, b.object);
+        };
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            const AABB& x = entries[a].box;
+            const AABB& y = entries[b].box;
+            int material = compareMaterials(entries[a].object->material, entries[b].object->material);
+            if (material != 0) {
+                return material < 0;
+            }
+            const float kx[5] = {x.min[u], x.max[u], x.min[v], x.max[v], x.min[axis]};
+            const float ky[5] = {y.min[u], y.max[u], y.min[v], y.max[v], y.min[axis]};
+            if (!std::equal(kx, kx + 5, ky)) {
+                return std::lexicographical_compare(kx, kx + 5, ky, ky + 5);
+            }
+            return a < b;
+        });
+
+        size_t merged = 0;
+        size_t run = 0;
+        while (run < order.size()) {
+            // Extend the run while the next box starts before the union so far ends
+            size_t end = run + 1;
+            size_t survivor = order[run];
+            float low = entries[survivor].box.min[axis];
+            float high = entries[survivor].box.max[axis];
+            while (end < order.size() && sameSlab(entries[order[end]], entries[order[run]]) &&
+                   entries[order[end]].box.min[axis] <= high) {
+                high = std::max(high, entries[order[end]].box.max[axis]);
+                survivor = std::min(survivor, order[end]);
+                end++;
+            }
+
+            // The member that comes first in the scene takes the union
+            for (size_t i = run; i < end; i++) {
+                if (order[i] != survivor) {
+                    entries[order[i]].alive = false;
+                    merged++;
+                }
+            }
+            entries[survivor].box.min[axis] = low;
+            entries[survivor].box.max[axis] = high;
+            run = end;
+        }
+        return merged;
+    }
+
+    size_t mergeBoxes(std::vector<Entry>& entries) {
+        std::vector<AABB> original(entries.size());
+        for (size_t i = 0; i < entries.size(); i++) {
+            original[i] = entries[i].box;
+        }
+
+        size_t total = 0;
+        int quietAxes = 0;
+        for (int axis = 0; quietAxes < 3; axis = (axis + 1) % 3) {
+            size_t merged = mergeAlong(entries, axis);
+            total += merged;
+            quietAxes = merged ? 0 : quietAxes + 1;
+        }
+
+        // Grown boxes become new cubes
+        for (size_t i = 0; i < entries.size(); i++) {
+            Entry& entry = entries[i];
+            if (entry.alive && (entry.box.min != original[i].min || entry.box.max != original[i].max)) {
+                Cube* cube = new Cube(entry.box.min, entry.box.max, entry.object->material);
+                delete entry.object;
+                entry.object = cube;
+            }
+        }
+        return total;
+    }
+
+    bool contains(const AABB& outer, const AABB& inner, bool allowTouching) {
+        for (int i = 0; i < 3; i++) {
+            bool inside = allowTouching ? outer.min[i] <= inner.min[i] && inner.max[i] <= outer.max[i]
+                                        : outer.min[i] < inner.min[i] && inner.max[i] < outer.max[i];
+            if (!inside) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Any box containing another also contains its min corner, so each object only has to be
+    // checked against the opaque boxes registered in the grid cell of that corner
+    size_t removeEnclosed(std::vector<Entry>& entries) {
+        std::vector<size_t> occluders;
+        AABB bounds;
+        for (size_t i = 0; i < entries.size(); i++) {
+            const Entry& entry = entries[i];
+            if (entry.alive && entry.object->type == PrimitiveType::Cube && entry.object->material.transparency <= 0.0f) {
+                occluders.push_back(i);
+                bounds.grow(entry.box);
+            }
+        }
+        if (occluders.empty()) {
+            return 0;
+        }
+
+        const int resolution = std::clamp(static_cast<int>(std::cbrt(static_cast<double>(occluders.size()))), 1, 64);
+        const glm::vec3 extent = glm::max(bounds.max - bounds.min, glm::vec3(1e-6f));
+        auto cellOf = [&](const glm::vec3& p) {
+            glm::ivec3 cell(glm::floor((p - bounds.min) / extent * static_cast<float>(resolution)));
+            return glm::clamp(cell, glm::ivec3(0), glm::ivec3(resolution - 1));
+        };
+        auto slot = [&](const glm::ivec3& cell) {
+            return (static_cast<size_t>(cell.z) * resolution + cell.y) * resolution + cell.x;
+        };
+
+        std::vector<std::vector<size_t>> cells(static_cast<size_t>(resolution) * resolution * resolution);
+        for (size_t index : occluders) {
+            glm::ivec3 low = cellOf(entries[index].box.min);
+            glm::ivec3 high = cellOf(entries[index].box.max);
+            for (int z = low.z; z <= high.z; z++) {
+                for (int y = low.y; y <= high.y; y++) {
+                    for (int x = low.x; x <= high.x; x++) {
+                        cells[slot(glm::ivec3(x, y, z))].push_back(index);
+                    }
+                }
+            }
+        }
+
+        // Hiding is transitive, so an occluder removed earlier still leaves a valid one behind.
+        // Equal boxes would hide each other; only the later one goes.
+        size_t removed = 0;
+        for (size_t i = 0; i < entries.size(); i++) {
+            Entry& entry = entries[i];
+            if (!entry.alive || !contains(bounds, entry.box, true)) {
+                continue;
+            }
+            for (size_t index : cells[slot(cellOf(entry.box.min))]) {
+                const Entry& occluder = entries[index];
+                if (index == i || (index > i && occluder.box.min == entry.box.min && occluder.box.max == entry.box.max)) {
+                    continue;
+                }
+                if (contains(occluder.box, entry.box, sameMaterial(occluder.object, entry.object))) {
+                    entry.alive = false;
+                    removed++;
+                    break;
+                }
+            }
+        }
+        return removed;
+    }
+}
+
+OptimizeReport optimizeScene(std::vector<Object*>& objects) {
+    OptimizeReport report;
+    report.before = objects.size();
+
+    std::vector<Entry> entries;
+    entries.reserve(objects.size());
+    for (Object* object : objects) {
+        Entry entry{object, object->getBounds()};
+        if (object->type == PrimitiveType::Cube) {
+            const Cube* cube = static_cast<const Cube*>(object);
+            // Fusing glass boxes would drop the faces between them, and with them a refraction
+            entry.mergeable = glm::all(glm::lessThanEqual(cube->getMinCorner(), cube->getMaxCorner())) &&
+                              cube->material.transparency <= 0.0f;
+        }
+        entries.push_back(entry);
+    }
+
+    // Merging first gives the enclosure test bigger boxes to work with
+    report.duplicates = removeDuplicates(entries);
+    report.merged = mergeBoxes(entries);
+    report.enclosed = removeEnclosed(entries);
+
+    objects.clear();
+    for (Entry& entry : entries) {
+        if (entry.alive) {
+            objects.push_back(entry.object);
+        } else {
+            delete entry.object;
+        }
+    }
+    report.after = objects.size();
+    return report;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "object.h"
+
+struct OptimizeReport {
+    size_t before = 0;
+    size_t duplicates = 0;  // exact copies of an earlier object
+    size_t merged = 0;  // boxes folded into a neighbour
+    size_t enclosed = 0;  // objects inside an opaque box
+    size_t after = 0;
+};
+
+// Simplifies an object list (allocated with new, as loadScene returns it) without
+// changing what a camera outside the geometry sees:
+//  - drops exact duplicates of an earlier object
+//  - merges opaque same-material boxes that share a whole face or overlap along one
+//    axis into one box, repeated until nothing changes
+//  - drops objects inside an opaque (non-transparent) box; touching its faces from
+//    the inside is only allowed with the same material, so no coplanar tie changes color
+// Boxes given with swapped corners are never merged, their normals depend on that order.
+// Removed objects are deleted; the survivors keep their relative order.
+OptimizeReport optimizeScene(std::vector<Object*>& objects);
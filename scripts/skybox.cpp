@@ -1,22 +1,34 @@
 #include "skybox.h"
+#include <cmath>
 #include "SDL_image.h"
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SKYBOX_SSE 1
+#endif
+
 Skybox::Skybox(const std::string& textureFile) {
     loadTexture(textureFile);
+    buildCubeMap();
 }
 
 Skybox::~Skybox() {
     SDL_FreeSurface(texture);
 }
 
-void Skybox::loadTexture(const std::string& textureFile) {
-    /*
-    texture = IMG_Load(textureFile.c_str());
-    if (!texture) {
-        throw std::runtime_error("Failed to load skybox texture: " + std::string(IMG_GetError()));
+void Skybox::load(const std::string& textureFile) {
+    SDL_Surface* previous = texture;
+    try {
+        loadTexture(textureFile);
+    } catch (...) {
+        texture = previous;
+        throw;
     }
-    */
+    SDL_FreeSurface(previous);
+    buildCubeMap();
+}
 
+void Skybox::loadTexture(const std::string& textureFile) {
     SDL_Surface* rawTexture = IMG_Load(textureFile.c_str());
     if (!rawTexture) {
         throw std::runtime_error("Failed to load skybox texture: " + std::string(IMG_GetError()));
@@ -30,7 +42,7 @@ void Skybox::loadTexture(const std::string& textureFile) {
     SDL_FreeSurface(rawTexture);
 }
 
-Color Skybox::getColor(const glm::vec3& direction) const {
+Color Skybox::getColorEquirect(const glm::vec3& direction) const {
     // Convert direction vector to spherical coordinates
     float phi = atan2(direction.z, direction.x);
     float theta = acos(direction.y);
@@ -55,4 +67,149 @@ Color Skybox::getColor(const glm::vec3& direction) const {
     b = pixel[2];
 
     return Color(r, g, b);
-}
\ No newline at end of file
+}
+
+// Face layout shared by the build and the lookups. Face f covers the directions whose
+// major axis is f / 2, positive for even f; (u, v) in [-1, 1] are the other two components
+// over the major one, v pointing down the image.
+namespace {
+    struct FaceCoords {
+        int face;
+        float u;
+        float v;
+    };
+
+    // Multiplies by the reciprocal of the major component like the SSE path, so both round alike
+    FaceCoords toFace(const glm::vec3& d) {
+        glm::vec3 a = glm::abs(d);
+        if (a.x >= a.y && a.x >= a.z) {
+            float inverse = 1.0f / a.x;
+            return d.x > 0 ? FaceCoords{0, -d.z * inverse, -d.y * inverse} : FaceCoords{1, d.z * inverse, -d.y * inverse};
+        }
+        if (a.y >= a.z) {
+            float inverse = 1.0f / a.y;
+            return d.y > 0 ? FaceCoords{2, d.x * inverse, d.z * inverse} : FaceCoords{3, d.x * inverse, -d.z * inverse};
+        }
+        float inverse = 1.0f / a.z;
+        return d.z > 0 ? FaceCoords{4, d.x * inverse, -d.y * inverse} : FaceCoords{5, -d.x * inverse, -d.y * inverse};
+    }
+
+    glm::vec3 fromFace(int face, float u, float v) {
+        switch (face) {
+            case 0: return glm::vec3(1.0f, -v, -u);
+            case 1: return glm::vec3(-1.0f, -v, u);
+            case 2: return glm::vec3(u, 1.0f, v);
+            case 3: return glm::vec3(u, -1.0f, -v);
+            case 4: return glm::vec3(u, -v, 1.0f);
+            default: return glm::vec3(-u, -v, -1.0f);
+        }
+    }
+}
+
+void Skybox::buildCubeMap() {
+    // A face spans 90 degrees, a quarter of the image width, so this keeps the equator resolution
+    faceSize = std::clamp(texture->w / 4, 16, 1024);
+    faces.resize(static_cast<size_t>(6) * faceSize * faceSize);
+    for (int face = 0; face < 6; face++) {
+        for (int t = 0; t < faceSize; t++) {
+            for (int s = 0; s < faceSize; s++) {
+                float u = (s + 0.5f) / faceSize * 2.0f - 1.0f;
+                float v = (t + 0.5f) / faceSize * 2.0f - 1.0f;
+                faces[(static_cast<size_t>(face) * faceSize + t) * faceSize + s] =
+                        getColorEquirect(glm::normalize(fromFace(face, u, v)));
+            }
+        }
+    }
+}
+
+Color Skybox::sample(int face, float s, float t) const {
+    const Color* texels = &faces[static_cast<size_t>(face) * faceSize * faceSize];
+    const int last = faceSize - 1;
+    if (!bilinear) {
+        int x = std::min(static_cast<int>(s), last);
+        int y = std::min(static_cast<int>(t), last);
+        return texels[y * faceSize + x];
+    }
+
+    // Texel centers sit at half-integers; across the face edges the border texel is repeated
+    float fx = std::clamp(s - 0.5f, 0.0f, static_cast<float>(last));
+    float fy = std::clamp(t - 0.5f, 0.0f, static_cast<float>(last));
+    int x0 = static_cast<int>(fx);
+    int y0 = static_cast<int>(fy);
+    int x1 = std::min(x0 + 1, last);
+    int y1 = std::min(y0 + 1, last);
+    float wx = fx - x0;
+    float wy = fy - y0;
+
+    const Color& c00 = texels[y0 * faceSize + x0];
+    const Color& c10 = texels[y0 * faceSize + x1];
+    const Color& c01 = texels[y1 * faceSize + x0];
+    const Color& c11 = texels[y1 * faceSize + x1];
+    auto mix = [&](Uint8 a, Uint8 b, Uint8 c, Uint8 d) {
+        float top = a + (b - a) * wx;
+        float bottom = c + (d - c) * wx;
+        return static_cast<int>(top + (bottom - top) * wy + 0.5f);
+    };
+    return Color(mix(c00.r, c10.r, c01.r, c11.r), mix(c00.g, c10.g, c01.g, c11.g), mix(c00.b, c10.b, c01.b, c11.b));
+}
+
+Color Skybox::getColor(const glm::vec3& direction) const {
+    FaceCoords f = toFace(direction);
+    const float half = 0.5f * faceSize;
+    return sample(f.face, std::clamp((f.u + 1.0f) * half, 0.0f, static_cast<float>(faceSize)),
+                  std::clamp((f.v + 1.0f) * half, 0.0f, static_cast<float>(faceSize)));
+}
+
+void Skybox::getColors(std::span<const glm::vec3> directions, std::span<Color> colors) const {
+    size_t i = 0;
+#ifdef SKYBOX_SSE
+    // Face selection and texel coordinates for four directions per iteration, then one
+    // scalar fetch (or bilinear blend) per lane
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 half = _mm_set1_ps(0.5f * faceSize);
+    const __m128 size = _mm_set1_ps(static_cast<float>(faceSize));
+    auto select = [](__m128 mask, __m128 a, __m128 b) {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    };
+    for (; i + 4 <= directions.size(); i += 4) {
+        const glm::vec3* d = &directions[i];
+        __m128 x = _mm_setr_ps(d[0].x, d[1].x, d[2].x, d[3].x);
+        __m128 y = _mm_setr_ps(d[0].y, d[1].y, d[2].y, d[3].y);
+        __m128 z = _mm_setr_ps(d[0].z, d[1].z, d[2].z, d[3].z);
+        __m128 ax = _mm_andnot_ps(signMask, x);
+        __m128 ay = _mm_andnot_ps(signMask, y);
+        __m128 az = _mm_andnot_ps(signMask, z);
+
+        // Same ties as toFace(): x wins over y and z, y over z
+        __m128 useX = _mm_and_ps(_mm_cmpge_ps(ax, ay), _mm_cmpge_ps(ax, az));
+        __m128 useY = _mm_andnot_ps(useX, _mm_cmpge_ps(ay, az));
+        __m128 positive = _mm_cmpgt_ps(select(useX, x, select(useY, y, z)), zero);
+
+        __m128 major = select(useX, ax, select(useY, ay, az));
+        __m128 negX = _mm_xor_ps(x, signMask);
+        __m128 negY = _mm_xor_ps(y, signMask);
+        __m128 negZ = _mm_xor_ps(z, signMask);
+        __m128 u = select(useX, select(positive, negZ, z), select(useY, x, select(positive, x, negX)));
+        __m128 v = select(useY, select(positive, z, negZ), negY);
+        __m128 inverse = _mm_div_ps(_mm_set1_ps(1.0f), major);
+        __m128 s = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(u, inverse), _mm_set1_ps(1.0f)), half), zero), size);
+        __m128 t = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(v, inverse), _mm_set1_ps(1.0f)), half), zero), size);
+        __m128 face = _mm_add_ps(select(useX, zero, select(useY, _mm_set1_ps(2.0f), _mm_set1_ps(4.0f))),
+                                 _mm_andnot_ps(positive, _mm_set1_ps(1.0f)));
+
+        alignas(16) float faceLanes[4];
+        alignas(16) float sLanes[4];
+        alignas(16) float tLanes[4];
+        _mm_store_ps(faceLanes, face);
+        _mm_store_ps(sLanes, s);
+        _mm_store_ps(tLanes, t);
+        for (int lane = 0; lane < 4; lane++) {
+            colors[i + lane] = sample(static_cast<int>(faceLanes[lane]), sLanes[lane], tLanes[lane]);
+        }
+    }
+#endif
+    for (; i < directions.size(); i++) {
+        colors[i] = getColor(directions[i]);
+    }
+}
@@ -1,17 +1,44 @@
 #pragma once
 
+#include <span>
 #include <string>
+#include <vector>
 #include "glm/glm.hpp"
 #include "color.h"
 
+// Environment texture for rays that leave the scene. The equirectangular image is
+// resampled once per load into a cube map, so a lookup picks the face by the major
+// axis of the direction and needs one divide instead of atan2/acos.
 class Skybox {
 public:
     Skybox(const std::string& textureFile);
     ~Skybox();
 
+    // Directions need not be normalized
     Color getColor(const glm::vec3& direction) const;
 
+    // getColor for every direction, four at a time with SSE. colors must be as long as directions.
+    void getColors(std::span<const glm::vec3> directions, std::span<Color> colors) const;
+
+    // The original per-ray lookup straight from the equirectangular image, which the cube map is built from
+    Color getColorEquirect(const glm::vec3& direction) const;
+
+    // Bilinear filtering between cube-map texels; nearest texel when off, the default
+    void setBilinear(bool enabled) { bilinear = enabled; }
+    bool isBilinear() const { return bilinear; }
+
+    // Replaces the texture, the current one stays when the new file cannot be loaded
+    void load(const std::string& textureFile);
+
 private:
     SDL_Surface* texture;
+    int faceSize = 0;
+    std::vector<Color> faces;  // +X, -X, +Y, -Y, +Z, -Z, faceSize x faceSize texels each
+    bool bilinear = false;
+
     void loadTexture(const std::string& textureFile);
-};
\ No newline at end of file
+    void buildCubeMap();
+
+    // Texel lookup for a face and continuous texel coordinates in [0, faceSize]
+    Color sample(int face, float s, float t) const;
+};
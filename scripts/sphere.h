@@ -5,13 +5,72 @@
 #include "material.h"
 #include "intersect.h"
 
-class Sphere : public Object {
+class Sphere final : public Object {
 public:
     Sphere(const glm::vec3& center, float radius, const Material& mat);
 
     Intersect rayIntersect(const glm::vec3& rayOrigin, const glm::vec3& rayDirection) const override;
 
+    // Non-virtual quadratic test, inlined into the typed loops of PrimitiveStore
+    Intersect intersect(const glm::vec3& rayOrigin, const glm::vec3& rayDirection) const;
+
+    bool occluded(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, float tMax, float* tHit = nullptr) const override;
+
+    // Non-virtual any-hit test without point or normal
+    bool occludes(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, float tMax, float* tHit = nullptr) const;
+
+    AABB getBounds() const override;
+
+    const glm::vec3& getCenter() const { return center; }
+    float getRadius() const { return radius; }
+
 private:
     glm::vec3 center;
     float radius;
-};
\ No newline at end of file
+};
+
+inline Intersect Sphere::intersect(const glm::vec3& rayOrigin, const glm::vec3& rayDirection) const {
+    glm::vec3 oc = rayOrigin - center;
+
+    float a = glm::dot(rayDirection, rayDirection);
+    float b = 2.0f * glm::dot(oc, rayDirection);
+    float c = glm::dot(oc, oc) - radius * radius;
+
+    float discriminant = b * b - 4 * a * c;
+
+    if (discriminant < 0) {
+        return Intersect{false};
+    }
+
+    float dist = (-b - sqrt(discriminant)) / (2.0f * a);
+
+    if (dist < 0) {
+        return Intersect{false};
+    }
+
+    glm::vec3 point = rayOrigin + dist * rayDirection;
+    glm::vec3 normal = glm::normalize(point - center);
+    return Intersect{true, dist, point, normal};
+}
+
+inline bool Sphere::occludes(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, float tMax, float* tHit) const {
+    glm::vec3 oc = rayOrigin - center;
+
+    float a = glm::dot(rayDirection, rayDirection);
+    float b = 2.0f * glm::dot(oc, rayDirection);
+    float c = glm::dot(oc, oc) - radius * radius;
+
+    float discriminant = b * b - 4 * a * c;
+    if (discriminant < 0) {
+        return false;
+    }
+
+    float dist = (-b - sqrt(discriminant)) / (2.0f * a);
+    if (dist < BIAS || dist > tMax) {
+        return false;
+    }
+    if (tHit) {
+        *tHit = dist;
+    }
+    return true;
+}
@@ -0,0 +1,105 @@
+#include "threadPool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    workerCount = threadCount;
+    queues = std::make_unique<TaskQueue[]>(workerCount);
+
+    // Worker 0 is whichever thread calls parallelFor
+    for (unsigned i = 1; i < workerCount; i++) {
+        threads.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::parallelFor(int count, const std::function<void(int)>& job) {
+    if (count <= 0) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        currentJob = &job;
+        pending.store(count);
+
+        // Deal contiguous chunks so neighbouring tasks start on the same worker
+        for (unsigned w = 0; w < workerCount; w++) {
+            int begin = static_cast<int>(static_cast<long long>(count) * w / workerCount);
+            int end = static_cast<int>(static_cast<long long>(count) * (w + 1) / workerCount);
+            std::lock_guard<std::mutex> queueLock(queues[w].mutex);
+            for (int i = end - 1; i >= begin; i--) {
+                queues[w].tasks.push_back(i);
+            }
+        }
+        generation++;
+    }
+    wake.notify_all();
+
+    runTasks(0);
+
+    std::unique_lock<std::mutex> lock(stateMutex);
+    done.wait(lock, [this] { return pending.load() == 0; });
+    currentJob = nullptr;
+}
+
+bool ThreadPool::popTask(unsigned self, int& task) {
+    {
+        TaskQueue& own = queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = own.tasks.back();
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    for (unsigned k = 1; k < workerCount; k++) {
+        TaskQueue& victim = queues[(self + k) % workerCount];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::runTasks(unsigned self) {
+    int task;
+    while (popTask(self, task)) {
+        (*currentJob)(task);
+        if (pending.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            done.notify_all();
+        }
+    }
+}
+
+void ThreadPool::workerLoop(unsigned self) {
+    unsigned long long seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(stateMutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+        }
+        runTasks(self);
+    }
+}
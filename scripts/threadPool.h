@@ -0,0 +1,50 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent pool with one task deque per worker. A worker pops its own
+// deque from the back and steals from the front of the others when it runs dry.
+class ThreadPool {
+public:
+    // threadCount == 0 uses std::thread::hardware_concurrency()
+    explicit ThreadPool(unsigned threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const { return workerCount; }
+
+    // Run job(i) for every i in [0, count) and block until all of them finished.
+    // The calling thread works as worker 0 while it waits.
+    void parallelFor(int count, const std::function<void(int)>& job);
+
+private:
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<int> tasks;
+    };
+
+    bool popTask(unsigned self, int& task);
+    void runTasks(unsigned self);
+    void workerLoop(unsigned self);
+
+    unsigned workerCount;
+    std::unique_ptr<TaskQueue[]> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex stateMutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    unsigned long long generation = 0;
+    bool stopping = false;
+
+    const std::function<void(int)>* currentJob = nullptr;
+    std::atomic<int> pending{0};
+};
@@ -0,0 +1,122 @@
+#include "toneMap.h"
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TONEMAP_SSE 1
+#endif
+
+namespace {
+    template <ToneMapOperator Op>
+    float curve(float x) {
+        if constexpr (Op == ToneMapOperator::Reinhard) {
+            return x / (1.0f + x);
+        } else if constexpr (Op == ToneMapOperator::ACES) {
+            return (x * (2.51f * x + 0.03f)) / (x * (2.43f * x + 0.59f) + 0.14f);
+        } else {
+            return x;
+        }
+    }
+
+    // Exposure and tone curve, clamped to [0, 1]. NaN ends up as 0 like in the SSE path.
+    template <ToneMapOperator Op>
+    float mapChannel(float value, float exposure) {
+        float x = value * exposure;
+        x = curve<Op>(x > 0.0f ? x : 0.0f);
+        return x < 1.0f ? (x > 0.0f ? x : 0.0f) : 1.0f;
+    }
+
+#ifdef TONEMAP_SSE
+    template <ToneMapOperator Op>
+    __m128 curve(__m128 x) {
+        if constexpr (Op == ToneMapOperator::Reinhard) {
+            return _mm_div_ps(x, _mm_add_ps(_mm_set1_ps(1.0f), x));
+        } else if constexpr (Op == ToneMapOperator::ACES) {
+            __m128 numerator = _mm_mul_ps(x, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.51f), x), _mm_set1_ps(0.03f)));
+            __m128 denominator = _mm_add_ps(_mm_mul_ps(x, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.43f), x), _mm_set1_ps(0.59f))),
+                                            _mm_set1_ps(0.14f));
+            return _mm_div_ps(numerator, denominator);
+        } else {
+            return x;
+        }
+    }
+
+    // One pixel in, r, g, b, a as int32 lanes scaled to [0, scale] out
+    template <ToneMapOperator Op>
+    __m128i mapPixel(const HDRColor& pixel, __m128 exposure, __m128 scale) {
+        const __m128 zero = _mm_setzero_ps();
+        __m128 x = _mm_max_ps(_mm_mul_ps(_mm_load_ps(&pixel.r), exposure), zero);
+        x = _mm_max_ps(_mm_min_ps(curve<Op>(x), _mm_set1_ps(1.0f)), zero);
+        return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(x, scale), _mm_set1_ps(0.5f)));
+    }
+#endif
+
+    template <ToneMapOperator Op>
+    void mapRange(const HDRColor* source, Color* target, size_t count, float exposure, const uint8_t* gammaTable,
+                  int tableSize) {
+        size_t i = 0;
+#ifdef TONEMAP_SSE
+        const __m128 exposureVec = _mm_set1_ps(exposure);
+        const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+        if (!gammaTable) {
+            const __m128 scale = _mm_set1_ps(255.0f);
+            for (; i + 4 <= count; i += 4) {
+                __m128i p0 = mapPixel<Op>(source[i], exposureVec, scale);
+                __m128i p1 = mapPixel<Op>(source[i + 1], exposureVec, scale);
+                __m128i p2 = mapPixel<Op>(source[i + 2], exposureVec, scale);
+                __m128i p3 = mapPixel<Op>(source[i + 3], exposureVec, scale);
+                __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(p0, p1), _mm_packs_epi32(p2, p3));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(target + i), _mm_or_si128(bytes, alpha));
+            }
+        } else {
+            const __m128 scale = _mm_set1_ps(static_cast<float>(tableSize - 1));
+            alignas(16) int32_t index[4];
+            for (; i < count; i++) {
+                _mm_store_si128(reinterpret_cast<__m128i*>(index), mapPixel<Op>(source[i], exposureVec, scale));
+                target[i].r = gammaTable[index[0]];
+                target[i].g = gammaTable[index[1]];
+                target[i].b = gammaTable[index[2]];
+                target[i].a = 255;
+            }
+        }
+#endif
+        for (; i < count; i++) {
+            float channels[3] = {mapChannel<Op>(source[i].r, exposure), mapChannel<Op>(source[i].g, exposure),
+                                 mapChannel<Op>(source[i].b, exposure)};
+            Uint8 bytes[3];
+            for (int c = 0; c < 3; c++) {
+                bytes[c] = gammaTable ? gammaTable[static_cast<int>(channels[c] * (tableSize - 1) + 0.5f)]
+                                      : static_cast<Uint8>(channels[c] * 255.0f + 0.5f);
+            }
+            target[i].r = bytes[0];
+            target[i].g = bytes[1];
+            target[i].b = bytes[2];
+            target[i].a = 255;
+        }
+    }
+}
+
+ToneMapper::ToneMapper(const ToneMapSettings& settings) : settings(settings) {
+    if (settings.gamma > 0.0f && settings.gamma != 1.0f) {
+        gammaTable.resize(GAMMA_TABLE_SIZE);
+        for (int i = 0; i < GAMMA_TABLE_SIZE; i++) {
+            float value = std::pow(static_cast<float>(i) / (GAMMA_TABLE_SIZE - 1), 1.0f / settings.gamma);
+            gammaTable[i] = static_cast<uint8_t>(value * 255.0f + 0.5f);
+        }
+    }
+}
+
+void ToneMapper::apply(const HDRColor* source, Color* target, size_t count) const {
+    const uint8_t* table = gammaTable.empty() ? nullptr : gammaTable.data();
+    switch (settings.op) {
+        case ToneMapOperator::Reinhard:
+            mapRange<ToneMapOperator::Reinhard>(source, target, count, settings.exposure, table, GAMMA_TABLE_SIZE);
+            break;
+        case ToneMapOperator::ACES:
+            mapRange<ToneMapOperator::ACES>(source, target, count, settings.exposure, table, GAMMA_TABLE_SIZE);
+            break;
+        default:
+            mapRange<ToneMapOperator::Clamp>(source, target, count, settings.exposure, table, GAMMA_TABLE_SIZE);
+            break;
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "color.h"
+#include "hdrColor.h"
+
+enum class ToneMapOperator {
+    Clamp,     // cuts everything above 1, the look of the old 8-bit pipeline
+    Reinhard,  // x / (1 + x)
+    ACES       // Narkowicz's fit of the ACES filmic curve
+};
+
+struct ToneMapSettings {
+    ToneMapOperator op = ToneMapOperator::Clamp;
+    float exposure = 1.0f;
+    float gamma = 1.0f;  // output = mapped^(1 / gamma), 1 leaves the authored colors as they are
+
+    bool operator==(const ToneMapSettings& other) const {
+        return op == other.op && exposure == other.exposure && gamma == other.gamma;
+    }
+};
+
+// Turns linear radiance into 8-bit pixels: exposure, tone curve, gamma and quantization
+// in one pass, four pixels per iteration with SSE2.
+class ToneMapper {
+public:
+    explicit ToneMapper(const ToneMapSettings& settings = {});
+
+    void apply(const HDRColor* source, Color* target, size_t count) const;
+
+    const ToneMapSettings& getSettings() const { return settings; }
+
+private:
+    // 8-bit output of every curve value in [0, 1], only built when gamma is not 1
+    static const int GAMMA_TABLE_SIZE = 4096;
+
+    ToneMapSettings settings;
+    std::vector<uint8_t> gammaTable;
+};
@@ -0,0 +1,287 @@
+#include "voxelGrid.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include "cube.h"
+
+VoxelGrid::VoxelGrid(const glm::vec3& origin, const glm::vec3& voxelSize, const glm::ivec3& size, const Material& material)
+        : Object(material, PrimitiveType::Voxels), origin(origin), voxelSize(voxelSize), size(glm::max(size, glm::ivec3(0))) {
+    bricksPerAxis = (this->size + BRICK - 1) / BRICK;
+    brickIndex.assign(static_cast<size_t>(bricksPerAxis.x) * bricksPerAxis.y * bricksPerAxis.z, -1);
+    palette.push_back(material);
+}
+
+int VoxelGrid::addMaterial(const Material& material) {
+    for (size_t i = 0; i < palette.size(); i++) {
+        if (std::memcmp(&palette[i], &material, sizeof(Material)) == 0) {
+            return static_cast<int>(i);
+        }
+    }
+    if (palette.size() >= MAX_MATERIALS) {
+        return EMPTY;
+    }
+    palette.push_back(material);
+    return static_cast<int>(palette.size() - 1);
+}
+
+void VoxelGrid::set(const glm::ivec3& voxel, int material) {
+    glm::ivec3 brick = voxel / BRICK;
+    int32_t& slot = brickIndex[brickSlot(brick)];
+    if (slot < 0) {
+        if (material == EMPTY) {
+            return;
+        }
+        slot = static_cast<int32_t>(bricks.size() / BRICK_VOXELS);
+        bricks.resize(bricks.size() + BRICK_VOXELS, 0);
+    }
+
+    uint8_t& value = bricks[static_cast<size_t>(slot) * BRICK_VOXELS + voxelSlot(voxel - brick * BRICK)];
+    uint8_t next = material == EMPTY ? 0 : static_cast<uint8_t>(material + 1);
+    solidCount += (next != 0) - (value != 0);
+    value = next;
+}
+
+int VoxelGrid::get(const glm::ivec3& voxel) const {
+    glm::ivec3 brick = voxel / BRICK;
+    int32_t slot = brickIndex[brickSlot(brick)];
+    if (slot < 0) {
+        return EMPTY;
+    }
+    return bricks[static_cast<size_t>(slot) * BRICK_VOXELS + voxelSlot(voxel - brick * BRICK)] - 1;
+}
+
+AABB VoxelGrid::getBounds() const {
+    return AABB(origin, origin + glm::vec3(size) * voxelSize);
+}
+
+bool VoxelGrid::trace(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, float tMin, float tMax,
+                      float& tHit, int& axis, int& value) const {
+    if (solidCount == 0) {
+        return false;
+    }
+
+    // Work in voxel units, where every voxel is a unit cube and t is unchanged
+    const float inf = std::numeric_limits<float>::infinity();
+    const glm::vec3 o = (rayOrigin - origin) / voxelSize;
+    const glm::vec3 d = rayDirection / voxelSize;
+    glm::vec3 invD;
+    glm::ivec3 step;
+    for (int i = 0; i < 3; i++) {
+        invD[i] = d[i] != 0.0f ? 1.0f / d[i] : inf;
+        step[i] = d[i] < 0.0f ? -1 : 1;
+    }
+
+    // Slab test against the whole grid, remembering the entry axis for the first normal
+    float tEnter = -inf;
+    float tExit = inf;
+    int enterAxis = 0;
+    for (int i = 0; i < 3; i++) {
+        if (d[i] == 0.0f) {
+            if (o[i] < 0.0f || o[i] > static_cast<float>(size[i])) {
+                return false;
+            }
+            continue;
+        }
+        float t0 = (0.0f - o[i]) * invD[i];
+        float t1 = (static_cast<float>(size[i]) - o[i]) * invD[i];
+        if (t0 > t1) {
+            std::swap(t0, t1);
+        }
+        if (t0 > tEnter) {
+            tEnter = t0;
+            enterAxis = i;
+        }
+        tExit = std::min(tExit, t1);
+    }
+    if (tEnter > tExit || tExit < tMin || tEnter > tMax) {
+        return false;
+    }
+    // Edge bricks can reach past the grid, so the walk ends at its exit, not at the last brick
+    tMax = std::min(tMax, tExit);
+
+    // Voxel and brick the ray starts in: where it enters the grid, or its origin when inside
+    const glm::vec3 start = o + d * std::max(tEnter, 0.0f);
+    const glm::ivec3 last = size - 1;
+    glm::ivec3 voxel = glm::clamp(glm::ivec3(glm::floor(start)), glm::ivec3(0), last);
+
+    // Outer DDA over bricks
+    const glm::ivec3 lastBrick = bricksPerAxis - 1;
+    glm::ivec3 brick = voxel / BRICK;
+    glm::vec3 brickNext;
+    glm::vec3 brickDelta;
+    for (int i = 0; i < 3; i++) {
+        float boundary = static_cast<float>((brick[i] + (step[i] > 0)) * BRICK);
+        brickNext[i] = d[i] != 0.0f ? (boundary - o[i]) * invD[i] : inf;
+        brickDelta[i] = d[i] != 0.0f ? BRICK * std::abs(invD[i]) : inf;
+    }
+    float brickEnter = tEnter;
+    int brickAxis = enterAxis;
+    bool firstBrick = true;
+
+    while (true) {
+        int32_t slot = brickIndex[brickSlot(brick)];
+        if (slot >= 0) {
+            // Inner DDA over the voxels of this brick, entered at brickEnter
+            const uint8_t* values = &bricks[static_cast<size_t>(slot) * BRICK_VOXELS];
+            const glm::ivec3 low = brick * BRICK;
+            const glm::ivec3 high = glm::min(low + (BRICK - 1), last);
+            if (!firstBrick) {
+                voxel = glm::clamp(glm::ivec3(glm::floor(o + d * brickEnter)), low, high);
+            }
+            glm::vec3 next;
+            glm::vec3 delta;
+            for (int i = 0; i < 3; i++) {
+                float boundary = static_cast<float>(voxel[i] + (step[i] > 0));
+                next[i] = d[i] != 0.0f ? (boundary - o[i]) * invD[i] : inf;
+                delta[i] = std::abs(invD[i]);
+            }
+            float voxelEnter = brickEnter;
+            int voxelAxis = brickAxis;
+
+            while (true) {
+                if (voxelEnter > tMax) {
+                    return false;
+                }
+                uint8_t v = values[voxelSlot(voxel - low)];
+                if (v != 0 && voxelEnter >= tMin) {
+                    tHit = voxelEnter;
+                    axis = voxelAxis;
+                    value = v - 1;
+                    return true;
+                }
+                int i = next.x < next.y ? (next.x < next.z ? 0 : 2) : (next.y < next.z ? 1 : 2);
+                voxel[i] += step[i];
+                if (voxel[i] < low[i] || voxel[i] > high[i]) {
+                    break;
+                }
+                voxelEnter = next[i];
+                voxelAxis = i;
+                next[i] += delta[i];
+            }
+        }
+
+        int i = brickNext.x < brickNext.y ? (brickNext.x < brickNext.z ? 0 : 2) : (brickNext.y < brickNext.z ? 1 : 2);
+        brick[i] += step[i];
+        if (brick[i] < 0 || brick[i] > lastBrick[i] || brickNext[i] > tMax) {
+            return false;
+        }
+        brickEnter = brickNext[i];
+        brickAxis = i;
+        brickNext[i] += brickDelta[i];
+        firstBrick = false;
+    }
+}
+
+Intersect VoxelGrid::intersect(const glm::vec3& rayOrigin, const glm::vec3& rayDirection) const {
+    float t;
+    int axis;
+    int value;
+    if (!trace(rayOrigin, rayDirection, 0.0f, std::numeric_limits<float>::max(), t, axis, value)) {
+        return Intersect{false};
+    }
+
+    glm::vec3 normal(0.0f);
+    normal[axis] = rayDirection[axis] < 0.0f ? 1.0f : -1.0f;
+    Intersect hit{true, t, rayOrigin + t * rayDirection, normal};
+    hit.material = &palette[value];
+    return hit;
+}
+
+Intersect VoxelGrid::rayIntersect(const glm::vec3& rayOrigin, const glm::vec3& rayDirection) const {
+    return intersect(rayOrigin, rayDirection);
+}
+
+bool VoxelGrid::occludes(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, float tMax, float* tHit) const {
+    float t;
+    int axis;
+    int value;
+    if (!trace(rayOrigin, rayDirection, BIAS, tMax, t, axis, value)) {
+        return false;
+    }
+    if (tHit) {
+        *tHit = t;
+    }
+    return true;
+}
+
+bool VoxelGrid::occluded(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, float tMax, float* tHit) const {
+    return occludes(rayOrigin, rayDirection, tMax, tHit);
+}
+
+namespace {
+    // Lattice coordinate of value when it lies within tolerance voxels of one
+    bool snap(float value, float voxelSize, float tolerance, int& index) {
+        float scaled = value / voxelSize;
+        float rounded = std::round(scaled);
+        if (std::abs(scaled - rounded) > tolerance) {
+            return false;
+        }
+        index = static_cast<int>(rounded);
+        return true;
+    }
+
+    struct SnappedCube {
+        const Cube* cube;
+        glm::ivec3 low;
+        glm::ivec3 high;  // exclusive
+    };
+}
+
+VoxelGrid* voxelizeCubes(std::vector<Object*>& objects, const glm::vec3& voxelSize, float tolerance) {
+    std::vector<SnappedCube> snapped;
+    glm::ivec3 low(std::numeric_limits<int>::max());
+    glm::ivec3 high(std::numeric_limits<int>::min());
+    for (const Object* object : objects) {
+        if (object->type != PrimitiveType::Cube) {
+            continue;
+        }
+        const Cube* cube = static_cast<const Cube*>(object);
+        AABB bounds = cube->getBounds();
+        SnappedCube s{cube};
+        bool aligned = true;
+        for (int i = 0; i < 3 && aligned; i++) {
+            aligned = snap(bounds.min[i], voxelSize[i], tolerance, s.low[i]) &&
+                      snap(bounds.max[i], voxelSize[i], tolerance, s.high[i]) && s.high[i] > s.low[i];
+        }
+        if (aligned) {
+            low = glm::min(low, s.low);
+            high = glm::max(high, s.high);
+            snapped.push_back(s);
+        }
+    }
+    if (snapped.empty()) {
+        return nullptr;
+    }
+
+    VoxelGrid* grid = new VoxelGrid(glm::vec3(low) * voxelSize, voxelSize, high - low, snapped.front().cube->material);
+    std::vector<const Object*> moved;
+    for (const SnappedCube& s : snapped) {
+        int material = grid->addMaterial(s.cube->material);
+        if (material == VoxelGrid::EMPTY) {
+            continue;  // palette full, this one stays a cube
+        }
+        for (int z = s.low.z; z < s.high.z; z++) {
+            for (int y = s.low.y; y < s.high.y; y++) {
+                for (int x = s.low.x; x < s.high.x; x++) {
+                    grid->set(glm::ivec3(x, y, z) - low, material);
+                }
+            }
+        }
+        moved.push_back(s.cube);
+    }
+
+    // snapped and moved follow the order of objects, so one pass removes them
+    size_t next = 0;
+    size_t kept = 0;
+    for (Object* object : objects) {
+        if (next < moved.size() && object == moved[next]) {
+            delete object;
+            next++;
+        } else {
+            objects[kept++] = object;
+        }
+    }
+    objects.resize(kept);
+    objects.push_back(grid);
+    return grid;
+}
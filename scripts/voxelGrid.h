@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+#include "object.h"
+#include "material.h"
+#include "intersect.h"
+
+// Axis-aligned block of voxels, each empty or one of up to 255 palette materials.
+// Storage is sparse at brick granularity: 8x8x8 voxel bricks are only allocated once
+// something is set in them. Rays walk the brick grid and then the voxels of each
+// non-empty brick with Amanatides-Woo 3D-DDA, so empty space costs one step per brick.
+class VoxelGrid final : public Object {
+public:
+    static const int BRICK = 8;
+    static const int EMPTY = -1;
+    static const int MAX_MATERIALS = 255;
+
+    // size voxels of voxelSize each, starting at origin, all empty. material becomes the
+    // grid's own Object material and palette entry 0.
+    VoxelGrid(const glm::vec3& origin, const glm::vec3& voxelSize, const glm::ivec3& size, const Material& material);
+
+    // Index of material in the palette, added if new. EMPTY when the palette is full.
+    int addMaterial(const Material& material);
+
+    // Palette index or EMPTY. Coordinates must lie inside size.
+    void set(const glm::ivec3& voxel, int material);
+    int get(const glm::ivec3& voxel) const;
+
+    Intersect rayIntersect(const glm::vec3& rayOrigin, const glm::vec3& rayDirection) const override;
+
+    // First voxel the ray enters at t >= 0. The hit carries that voxel's material.
+    Intersect intersect(const glm::vec3& rayOrigin, const glm::vec3& rayDirection) const;
+
+    bool occluded(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, float tMax, float* tHit = nullptr) const override;
+
+    // Any voxel entered at BIAS <= t <= tMax. A ray starting inside a voxel is not blocked by it,
+    // which lets shadow rays start on the grid's own surface.
+    bool occludes(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, float tMax, float* tHit = nullptr) const;
+
+    AABB getBounds() const override;
+
+    const glm::vec3& getOrigin() const { return origin; }
+    const glm::vec3& getVoxelSize() const { return voxelSize; }
+    const glm::ivec3& getSize() const { return size; }
+    const std::vector<Material>& getPalette() const { return palette; }
+    size_t voxelCount() const { return solidCount; }
+    size_t brickCount() const { return bricks.size() / BRICK_VOXELS; }
+
+private:
+    static const int BRICK_VOXELS = BRICK * BRICK * BRICK;
+
+    // Walks the grid front to back and stops at the first solid voxel entered at t >= tMin.
+    // Returns its entry distance, the axis of the face it was entered through and its value.
+    bool trace(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, float tMin, float tMax,
+               float& tHit, int& axis, int& value) const;
+
+    int brickSlot(const glm::ivec3& brick) const {
+        return (brick.z * bricksPerAxis.y + brick.y) * bricksPerAxis.x + brick.x;
+    }
+
+    static int voxelSlot(const glm::ivec3& local) {
+        return (local.z * BRICK + local.y) * BRICK + local.x;
+    }
+
+    glm::vec3 origin;
+    glm::vec3 voxelSize;
+    glm::ivec3 size;
+    glm::ivec3 bricksPerAxis;
+    std::vector<int32_t> brickIndex;  // per brick, offset into bricks / BRICK_VOXELS or -1 when empty
+    std::vector<uint8_t> bricks;  // BRICK_VOXELS values per allocated brick, 0 empty, else palette index + 1
+    std::vector<Material> palette;
+    size_t solidCount = 0;
+};
+
+// Moves every Cube of objects whose corners lie on the voxelSize lattice, within tolerance
+// voxels, into one new VoxelGrid appended to objects. Later cubes overwrite earlier ones where
+// they overlap. Moved cubes are deleted; other objects are kept as they are. Returns the grid,
+// or nullptr when no cube qualified.
+VoxelGrid* voxelizeCubes(std::vector<Object*>& objects, const glm::vec3& voxelSize, float tolerance = 0.15f);